@@ -0,0 +1,358 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <sched.h>
+#include <sys/socket.h>
+#include "error_detection.h"
+#include "detector.h"
+#include "error_injection.h"
+#include "corruption_trace.h"
+#include "socket_io.h"
+#include "packet_forwarder.h"
+
+// Microbenchmarks of every ErrorDetection, Detector and ErrorInjection function over
+// payload sizes from 16 B to 64 MB, and of the server's forwarding path. Each
+// function is timed in batches of calls; the median batch gives ns/call, from
+// which ns/byte and GB/s follow. Heap allocations are counted by replacing the
+// global operator new. The forwarding path must make none once warmed up; if
+// it does, bench says so and exits with status 1.
+
+#define MIN_SIZE 16
+#define MAX_SIZE (64 * 1024 * 1024)
+#define SIZE_STEP 4
+#define BATCHES 5
+#define DEFAULT_MIN_TIME_MS 100
+
+std::atomic<uint64_t> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// Results are folded in here so the compiler cannot drop the calls
+volatile uint64_t sink;
+
+// Generator for the in-place injectors, fixed so runs are comparable
+Xoshiro256 generator(1);
+
+// Input of one payload size: the pristine payload, its SECDED control
+// information, a scratch copy the in-place injectors may corrupt and a CRC-32
+// frame of the payload as Client 1 sends it
+struct Payload {
+    std::string data;
+    std::string secded;
+    std::string scratch;
+    std::string frame;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(Payload&)> run;
+    bool allocationFree = false;    // Any allocation in steady state is an error
+};
+
+struct Result {
+    std::string name;
+    size_t bytes;
+    uint64_t calls;
+    double nsPerCall;
+    double allocsPerCall;
+};
+
+// The server's forwarding path: the PacketForwarder the workers use, given
+// each frame as a Message from a MessageReader fed the way the io_uring
+// workers feed theirs. The "random" channel corrupts every packet, so the
+// payload is always copied into the arena. Forwarded frames go to a local
+// socket with one sendmsg(), and the other end is drained as Client 2 would.
+class ForwardPath : public PacketForwarder {
+public:
+    explicit ForwardPath(TraceWriter& trace)
+        : PacketForwarder(trace, true), reader_(-1, MAX_SIZE + 1024 * 1024),
+          channel_(ChannelModel::create("random", 1)), drain_(1024 * 1024) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds_) < 0 || !setNonBlocking(fds_[0]) || !setNonBlocking(fds_[1])) {
+            std::cerr << "socketpair failed: " << std::strerror(errno) << std::endl;
+            std::exit(1);
+        }
+    }
+
+    ~ForwardPath() override {
+        close(fds_[0]);
+        close(fds_[1]);
+    }
+
+    size_t forward(const std::string& frame) {
+        reader_.feed(reinterpret_cast<const uint8_t*>(frame.data()), frame.size());
+        if (reader_.next(message_) != ReadStatus::OK || !forwardPacket(arena_, *channel_, 0, message_)) {
+            std::cerr << "Forwarding a frame failed" << std::endl;
+            std::exit(1);
+        }
+        return message_.size;
+    }
+
+protected:
+    void output(const std::string&) override {}
+
+    bool sendPersistent(const iovec* parts, int count) override {
+        FlushStatus status = out_.sendv(fds_[0], parts, count);
+        for (;;) {
+            while (recv(fds_[1], drain_.data(), drain_.size(), 0) > 0) {}
+            if (status != FlushStatus::PENDING) return status == FlushStatus::DONE;
+            status = out_.flush(fds_[0]);
+        }
+    }
+
+    bool sendOneShot(const iovec*, int) override { return false; }
+
+private:
+    int fds_[2];
+    MessageReader reader_;
+    Message message_;
+    FrameArena arena_;
+    WriteBuffer out_;
+    std::unique_ptr<ChannelModel> channel_;
+    std::vector<char> drain_;
+};
+
+std::vector<Benchmark> makeBenchmarks() {
+    std::vector<Benchmark> list;
+    auto detector = [&list](const char* name, std::string (*fn)(const std::string&)) {
+        list.push_back({name, [fn](Payload& p) { sink = sink + fn(p.data).size(); }});
+    };
+    detector("ErrorDetection::calculateParity", [](const std::string& d) { return ErrorDetection::calculateParity(d); });
+    detector("ErrorDetection::calculate2DParity", [](const std::string& d) { return ErrorDetection::calculate2DParity(d); });
+    detector("ErrorDetection::calculateCRC16", ErrorDetection::calculateCRC16);
+    detector("ErrorDetection::calculateHamming", ErrorDetection::calculateHamming);
+    detector("ErrorDetection::calculateChecksum", ErrorDetection::calculateChecksum);
+    detector("ErrorDetection::calculateCRC16CCITT", ErrorDetection::calculateCRC16CCITT);
+    detector("ErrorDetection::calculateCRC32", ErrorDetection::calculateCRC32);
+    detector("ErrorDetection::calculateCRC32C", ErrorDetection::calculateCRC32C);
+    detector("ErrorDetection::calculateCRC64", ErrorDetection::calculateCRC64);
+    detector("ErrorDetection::calculateSECDED", ErrorDetection::calculateSECDED);
+    list.push_back({"ErrorDetection::computeCRC16", [](Payload& p) {
+        sink = sink + ErrorDetection::computeCRC16(p.data);
+    }});
+    list.push_back({"ErrorDetection::computeChecksum", [](Payload& p) {
+        sink = sink + ErrorDetection::computeChecksum(p.data);
+    }});
+    list.push_back({"ErrorDetection::decodeSECDED", [](Payload& p) {
+        sink = sink + ErrorDetection::decodeSECDED(p.data, p.secded).correctedBits;
+    }});
+
+    // Typed control values, compared the way Client 2 checks binary frames
+    auto typed = [&list](auto policy) {
+        using PolicyDetector = Detector<decltype(policy)>;
+        list.push_back({"Detector<" + ErrorDetection::methodToString(PolicyDetector::METHOD) + ">::verify",
+                        [](Payload& p) { sink = sink + PolicyDetector::verify(p.data, {}); }});
+    };
+    std::apply([&typed](auto... policy) { (typed(policy), ...); }, DetectorPolicies{});
+
+    // In-place injectors corrupt the scratch copy; its length is reset
+    // before every call but its contents are not restored
+    using InPlace = bool (*)(char*, size_t&, size_t, Xoshiro256&, CorruptionEdits*);
+    auto inPlace = [&list](const char* name, InPlace fn) {
+        list.push_back({name, [fn](Payload& p) {
+            size_t length = p.data.size();
+            fn(&p.scratch[0], length, p.scratch.size(), generator, nullptr);
+            sink = sink + length;
+        }});
+    };
+    inPlace("ErrorInjection::injectBitFlip(in place)", ErrorInjection::injectBitFlip);
+    inPlace("ErrorInjection::injectCharSubstitution(in place)", ErrorInjection::injectCharSubstitution);
+    inPlace("ErrorInjection::injectCharDeletion(in place)", ErrorInjection::injectCharDeletion);
+    inPlace("ErrorInjection::injectCharInsertion(in place)", ErrorInjection::injectCharInsertion);
+    inPlace("ErrorInjection::injectCharSwapping(in place)", ErrorInjection::injectCharSwapping);
+    inPlace("ErrorInjection::injectMultipleBitFlips(in place)", ErrorInjection::injectMultipleBitFlips);
+    inPlace("ErrorInjection::injectBurstError(in place)", ErrorInjection::injectBurstError);
+    list.push_back({"ErrorInjection::injectError(in place)", [](Payload& p) {
+        size_t length = p.data.size();
+        ErrorInjection::injectError(&p.scratch[0], length, p.scratch.size(), generator);
+        sink = sink + length;
+    }});
+
+    list.push_back({"PacketForwarder::forwardPacket(random)", [](Payload& p) {
+        static TraceWriter noTrace;
+        static ForwardPath path(noTrace);
+        sink = sink + path.forward(p.frame);
+    }, true});
+    list.push_back({"PacketForwarder::forwardPacket(random, traced)", [](Payload& p) {
+        static TraceWriter trace;
+        static ForwardPath path(trace);
+        if (!trace.isOpen() && !trace.open("/dev/null", 1, "random")) {
+            std::cerr << "Opening the trace failed: " << std::strerror(errno) << std::endl;
+            std::exit(1);
+        }
+        sink = sink + path.forward(p.frame);
+    }, true});
+
+    // String wrappers return a corrupted copy
+    auto copying = [&list](const char* name, std::string (*fn)(const std::string&)) {
+        list.push_back({name, [fn](Payload& p) { sink = sink + fn(p.data).size(); }});
+    };
+    copying("ErrorInjection::injectBitFlip", ErrorInjection::injectBitFlip);
+    copying("ErrorInjection::injectCharSubstitution", ErrorInjection::injectCharSubstitution);
+    copying("ErrorInjection::injectCharDeletion", ErrorInjection::injectCharDeletion);
+    copying("ErrorInjection::injectCharInsertion", ErrorInjection::injectCharInsertion);
+    copying("ErrorInjection::injectCharSwapping", ErrorInjection::injectCharSwapping);
+    copying("ErrorInjection::injectMultipleBitFlips", ErrorInjection::injectMultipleBitFlips);
+    copying("ErrorInjection::injectBurstError", ErrorInjection::injectBurstError);
+    copying("ErrorInjection::injectError", ErrorInjection::injectError);
+    return list;
+}
+
+// Time one function on one payload: grow the batch until it takes at least
+// minTime / BATCHES, then run BATCHES batches and keep the median
+Result measure(const Benchmark& benchmark, Payload& payload, double minTimeNs) {
+    using Clock = std::chrono::steady_clock;
+    auto timeBatch = [&](uint64_t calls) {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < calls; i++) benchmark.run(payload);
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    benchmark.run(payload); // Warm up caches and lazily built tables
+    uint64_t calls = 1;
+    double batchTarget = minTimeNs / BATCHES;
+    double elapsed = timeBatch(calls);
+    while (elapsed < batchTarget) {
+        calls = elapsed > 0 ? std::max(calls * 2, static_cast<uint64_t>(calls * batchTarget / elapsed * 1.2))
+                            : calls * 16;
+        elapsed = timeBatch(calls);
+    }
+
+    std::vector<double> perCall;
+    perCall.reserve(BATCHES);
+    uint64_t before = allocations.load(std::memory_order_relaxed);
+    for (int b = 0; b < BATCHES; b++) {
+        perCall.push_back(timeBatch(calls) / calls);
+    }
+    uint64_t allocated = allocations.load(std::memory_order_relaxed) - before;
+    std::sort(perCall.begin(), perCall.end());
+
+    return {benchmark.name, payload.data.size(), calls * BATCHES, perCall[BATCHES / 2],
+            static_cast<double>(allocated) / (calls * BATCHES)};
+}
+
+// Keep the benchmark on one core so frequency and cache state stay put
+bool pinToCpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+void printResult(const Result& result, bool json, bool first) {
+    double nsPerByte = result.nsPerCall / result.bytes;
+    double gbPerSecond = result.bytes / result.nsPerCall;
+    char line[512];
+    if (json) {
+        std::snprintf(line, sizeof(line),
+                      "%s    {\"function\": \"%s\", \"bytes\": %zu, \"calls\": %llu, \"ns_per_call\": %.3f, "
+                      "\"ns_per_byte\": %.6f, \"gb_per_s\": %.4f, \"allocs_per_call\": %.3f}",
+                      first ? "" : ",\n", result.name.c_str(), result.bytes,
+                      static_cast<unsigned long long>(result.calls), result.nsPerCall, nsPerByte,
+                      gbPerSecond, result.allocsPerCall);
+    } else {
+        std::snprintf(line, sizeof(line), "\"%s\",%zu,%llu,%.3f,%.6f,%.4f,%.3f\n",
+                      result.name.c_str(), result.bytes, static_cast<unsigned long long>(result.calls),
+                      result.nsPerCall, nsPerByte, gbPerSecond, result.allocsPerCall);
+    }
+    std::cout << line << std::flush;
+}
+
+int main(int argc, char* argv[]) {
+    // --cpu N pins to core N (default: the core the process starts on).
+    // --min-time MS is the time spent measuring each function and size.
+    // --max-size N stops at payloads of N bytes.
+    // --filter TEXT runs only functions whose name contains TEXT.
+    // --json prints JSON instead of CSV.
+    int cpu = sched_getcpu();
+    double minTimeMs = DEFAULT_MIN_TIME_MS;
+    size_t maxSize = MAX_SIZE;
+    std::string filter;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--cpu") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) >= 0) {
+            cpu = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc && std::atof(argv[i + 1]) > 0) {
+            minTimeMs = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc && std::atoll(argv[i + 1]) >= MIN_SIZE) {
+            maxSize = static_cast<size_t>(std::atoll(argv[++i]));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--cpu N] [--min-time MS] [--max-size N] [--filter TEXT] [--json]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (cpu < 0 || !pinToCpu(cpu)) {
+        std::cerr << "Pinning to CPU " << cpu << " failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    ErrorInjection::seed(1);
+
+    std::vector<Benchmark> benchmarks = makeBenchmarks();
+    if (json) {
+        std::cout << "{\n  \"cpu\": " << cpu << ",\n  \"cpu_level\": \""
+                  << CpuDispatch::levelToString(CpuDispatch::level()) << "\",\n  \"min_time_ms\": " << minTimeMs
+                  << ",\n  \"results\": [\n";
+    } else {
+        std::cout << "function,bytes,calls,ns_per_call,ns_per_byte,gb_per_s,allocs_per_call\n";
+    }
+
+    bool first = true;
+    std::vector<Result> allocating;     // Results of allocation-free paths that allocated
+    Payload payload;
+    for (size_t size = MIN_SIZE; size <= maxSize; size *= SIZE_STEP) {
+        // Printable text, like the data Client 1 sends
+        payload.data.resize(size);
+        Xoshiro256 gen(size);
+        for (size_t i = 0; i < size; i++) payload.data[i] = static_cast<char>(32 + gen() % 95);
+        payload.secded = ErrorDetection::calculateSECDED(payload.data);
+        payload.scratch = payload.data;
+        payload.scratch.resize(size + ErrorInjection::MAX_GROWTH);
+        std::string crc;
+        Detector<Crc32Policy>::appendBytes(crc, Detector<Crc32Policy>::compute(payload.data));
+        payload.frame.clear();
+        PacketFrame::build(payload.frame, ErrorDetectionMethod::CRC32, size, payload.data, crc);
+
+        for (const Benchmark& benchmark : benchmarks) {
+            if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) continue;
+            Result result = measure(benchmark, payload, minTimeMs * 1e6);
+            printResult(result, json, first);
+            first = false;
+            if (benchmark.allocationFree && result.allocsPerCall > 0) allocating.push_back(result);
+        }
+    }
+
+    if (json) std::cout << "\n  ]\n}\n";
+    for (const Result& result : allocating) {
+        std::cerr << result.name << " allocated " << result.allocsPerCall << " time(s) per call on "
+                  << result.bytes << "-byte payloads" << std::endl;
+    }
+    return allocating.empty() ? 0 : 1;
+}
@@ -1,52 +1,261 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include "error_detection.h"
+#include "detector.h"
+#include "packet_frame.h"
+#include "socket_io.h"
+#include "shm_ring.h"
+#include "udp_io.h"
 
 #define SERVER_PORT 8080
 #define SERVER_IP "127.0.0.1"
+#define RING_TIMEOUT_MS 200
+#define FILE_CHUNK_SIZE (64 * 1024)
+#define FILE_MAX_CHUNK (2 * 1024 * 1024)   // A SECDED frame of it still fits the shared-memory ring
+#define FILE_METHOD 7                       // CRC-32 in the menu
+#define FILE_CONTROL_THREADS 4
+#define FILE_CONTROL_AHEAD 64               // Chunks whose control info may be ready before they are sent
+#define FILE_SEND_BATCH 16                  // Frames per sendmsg()
 
-int main() {
-    // Create socket
-    int clientSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (clientSocket < 0) {
-        std::cerr << "Socket creation failed" << std::endl;
-        return 1;
+// Error detection methods in menu order
+const ErrorDetectionMethod MENU_METHODS[] = {
+    ErrorDetectionMethod::PARITY, ErrorDetectionMethod::PARITY_2D, ErrorDetectionMethod::CRC16,
+    ErrorDetectionMethod::HAMMING, ErrorDetectionMethod::CHECKSUM, ErrorDetectionMethod::CRC16_CCITT,
+    ErrorDetectionMethod::CRC32, ErrorDetectionMethod::CRC32C, ErrorDetectionMethod::CRC64,
+    ErrorDetectionMethod::HAMMING_SECDED
+};
+const int MENU_SIZE = sizeof(MENU_METHODS) / sizeof(MENU_METHODS[0]);
+
+// Write a frame straight into the shared-memory ring, where the server
+// corrupts it and Client 2 checks it
+bool writeToRing(ShmRing& ring, ErrorDetectionMethod method, uint64_t sequence, std::string_view data,
+                 std::string_view control, uint16_t flags = 0) {
+    size_t frameSize = PacketFrame::HEADER_SIZE + data.size() + control.size();
+    uint8_t* frame;
+    RingStatus status;
+    do {
+        status = ring.reserve(frameSize, frame, RING_TIMEOUT_MS);
+    } while (status == RingStatus::TIMEOUT && !shutdownRequested());
+    if (status != RingStatus::OK) {
+        std::cerr << (status == RingStatus::TOO_LARGE ? "Packet too large for the shared-memory ring"
+                                                      : "Client 2 closed the shared-memory ring") << std::endl;
+        return false;
     }
+    PacketFrame::writeHeader(frame, method, sequence, data.size(), control.size(), flags);
+    std::memcpy(frame + PacketFrame::HEADER_SIZE, data.data(), data.size());
+    std::memcpy(frame + PacketFrame::HEADER_SIZE + data.size(), control.data(), control.size());
+    ring.commit();
+    return true;
+}
 
-    // Setup server address
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(SERVER_PORT);
-    if (inet_aton(SERVER_IP, &serverAddr.sin_addr) == 0) {
-        std::cerr << "Invalid address" << std::endl;
-        close(clientSocket);
-        return 1;
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_) munmap(data_, size_);
     }
 
-    // Connect to server
-    if (connect(clientSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Connection failed" << std::endl;
-        close(clientSocket);
-        return 1;
+    bool open(const char* path, std::string& error) {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) < 0) {
+            error = std::strerror(errno);
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                error = std::strerror(errno);
+                close(fd);
+                return false;
+            }
+            data_ = data;
+            madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        return true;
     }
 
-    std::cout << "Connected to server!" << std::endl;
-    std::cout << "\n=== Client 1: Data Sender ===" << std::endl;
+    std::string_view view() const { return std::string_view(static_cast<const char*>(data_), size_); }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Computes the control info of a file's chunks on a few threads while the
+// sender sends them in order. Workers stay at most FILE_CONTROL_AHEAD chunks
+// ahead of the sender, so memory use does not grow with the file.
+class ControlPipeline {
+public:
+    ControlPipeline(std::string_view file, size_t chunkSize, ErrorDetectionMethod method, unsigned threads)
+        : file_(file), chunkSize_(chunkSize), method_(method),
+          count_((file.size() + chunkSize - 1) / chunkSize), slots_(FILE_CONTROL_AHEAD) {
+        for (unsigned i = 0; i < threads; i++) threads_.emplace_back(&ControlPipeline::work, this);
+    }
+
+    ~ControlPipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        space_.notify_all();
+        for (std::thread& thread : threads_) thread.join();
+    }
+
+    size_t chunks() const { return count_; }
+
+    std::string_view chunk(size_t index) const {
+        return file_.substr(index * chunkSize_, chunkSize_);
+    }
+
+    // Control bytes of a chunk, once computed; valid until sent(index)
+    const std::string& control(size_t index) {
+        Slot& slot = slots_[index % slots_.size()];
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return slot.chunk == index + 1; });
+        return slot.control;
+    }
+
+    // The chunk is on its way; its slot may take a later chunk
+    void sent(size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sent_ = index + 1;
+        }
+        space_.notify_all();
+    }
+
+private:
+    struct Slot {
+        std::string control;
+        size_t chunk = 0;       // Index + 1 of the chunk whose control is ready
+    };
+
+    std::string_view file_;
+    size_t chunkSize_;
+    ErrorDetectionMethod method_;
+    size_t count_;
+    std::vector<Slot> slots_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_{0};
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    size_t sent_ = 0;
+    bool stopping_ = false;
+
+    void work() {
+        for (;;) {
+            size_t index = next_.fetch_add(1, std::memory_order_relaxed);
+            if (index >= count_) return;
+            Slot& slot = slots_[index % slots_.size()];
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                space_.wait(lock, [&] { return stopping_ || index < sent_ + slots_.size(); });
+                if (stopping_) return;
+            }
+            std::string_view data = chunk(index);
+            slot.control.clear();
+            withDetectorPolicy(method_, [&](auto policy) {
+                using MethodDetector = Detector<decltype(policy)>;
+                MethodDetector::appendBytes(slot.control, MethodDetector::compute(data));
+            });
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                slot.chunk = index + 1;
+            }
+            ready_.notify_all();
+        }
+    }
+};
+
+// Send a file as one frame per chunk, without waiting for anything between
+// them: over TCP up to FILE_SEND_BATCH frames leave in one sendmsg() straight
+// from the mapping, or each goes into the shared-memory ring. Every frame is
+// flagged as a file chunk and carries its byte offset as sequence number.
+bool sendFile(int clientSocket, ShmRing* ring, const char* path, size_t chunkSize, ErrorDetectionMethod method) {
+    MappedFile file;
+    std::string error;
+    if (!file.open(path, error)) {
+        std::cerr << "Cannot read " << path << ": " << error << std::endl;
+        return false;
+    }
+    unsigned threads = std::min(std::max(1u, std::thread::hardware_concurrency()), static_cast<unsigned>(FILE_CONTROL_THREADS));
+    ControlPipeline pipeline(file.view(), chunkSize, method, threads);
+    std::cout << "\nSending " << path << " (" << file.view().size() << " bytes) as " << pipeline.chunks()
+              << " chunk(s) of up to " << chunkSize << " bytes, " << ErrorDetection::methodToString(method)
+              << " computed on " << threads << " thread(s)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    uint8_t headers[FILE_SEND_BATCH][PacketFrame::HEADER_SIZE];
+    iovec parts[FILE_SEND_BATCH * 3];
+    for (size_t first = 0; first < pipeline.chunks(); first += FILE_SEND_BATCH) {
+        size_t last = std::min(first + FILE_SEND_BATCH, pipeline.chunks());
+        int count = 0;
+        for (size_t index = first; index < last; index++) {
+            std::string_view data = pipeline.chunk(index);
+            const std::string& control = pipeline.control(index);
+            uint64_t offset = static_cast<uint64_t>(index) * chunkSize;
+            if (ring) {
+                if (!writeToRing(*ring, method, offset, data, control, PacketFrame::FLAG_FILE_CHUNK)) return false;
+                pipeline.sent(index);
+                continue;
+            }
+            uint8_t* header = headers[index - first];
+            PacketFrame::writeHeader(header, method, offset, data.size(), control.size(), PacketFrame::FLAG_FILE_CHUNK);
+            parts[count++] = {header, PacketFrame::HEADER_SIZE};
+            parts[count++] = {const_cast<char*>(data.data()), data.size()};
+            parts[count++] = {const_cast<char*>(control.data()), control.size()};
+        }
+        if (ring) continue;
+        if (!sendAllv(clientSocket, parts, count)) {
+            std::cerr << "Send failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        pipeline.sent(last - 1);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Sent " << pipeline.chunks() << " chunk(s) in " << seconds << " s ("
+              << (seconds > 0 ? file.view().size() / seconds / 1e6 : 0.0) << " MB/s)" << std::endl;
+    return true;
+}
 
+// Read one packet from the user and send it, to the ring or as a datagram if
+// one of those is in use; false on empty input or error
+bool sendPacket(int clientSocket, ShmRing* ring, DatagramSender* datagrams, bool legacyMode, uint64_t sequence) {
     // Get input from user
     std::string data;
     std::cout << "Enter data to send: ";
-    std::getline(std::cin, data);
+    if (!std::getline(std::cin, data)) data.clear();
 
     if (data.empty()) {
         std::cout << "Empty data, exiting..." << std::endl;
-        close(clientSocket);
-        return 0;
+        return false;
     }
 
     // Select error detection method
@@ -56,62 +265,197 @@ int main() {
     std::cout << "3. CRC-16" << std::endl;
     std::cout << "4. Hamming Code" << std::endl;
     std::cout << "5. Internet Checksum" << std::endl;
-    std::cout << "Choice (1-5): ";
+    std::cout << "6. CRC-16/CCITT" << std::endl;
+    std::cout << "7. CRC-32" << std::endl;
+    std::cout << "8. CRC-32C" << std::endl;
+    std::cout << "9. CRC-64" << std::endl;
+    std::cout << "10. Extended Hamming (SECDED, corrects single-bit errors)" << std::endl;
+    std::cout << "Choice (1-10): ";
 
-    int choice;
+    int choice = 0;
     std::cin >> choice;
     std::cin.ignore(); // Clear newline
 
-    std::string methodStr;
-    std::string controlInfo;
+    ErrorDetectionMethod method = ErrorDetectionMethod::PARITY;
+    if (choice >= 1 && choice <= MENU_SIZE) {
+        method = MENU_METHODS[choice - 1];
+    } else {
+        std::cout << "Invalid choice, using Parity Bit" << std::endl;
+    }
 
-    switch (choice) {
-        case 1:
-            methodStr = "PARITY";
-            controlInfo = ErrorDetection::calculateParity(data, true);
-            break;
-        case 2:
-            methodStr = "PARITY2D";
-            controlInfo = ErrorDetection::calculate2DParity(data);
-            break;
-        case 3:
-            methodStr = "CRC16";
-            controlInfo = ErrorDetection::calculateCRC16(data);
-            break;
-        case 4:
-            methodStr = "HAMMING";
-            controlInfo = ErrorDetection::calculateHamming(data);
-            break;
-        case 5:
-            methodStr = "CHECKSUM";
-            controlInfo = ErrorDetection::calculateChecksum(data);
-            break;
-        default:
-            std::cout << "Invalid choice, using Parity Bit" << std::endl;
-            methodStr = "PARITY";
-            controlInfo = ErrorDetection::calculateParity(data, true);
-            break;
-    }
-
-    // Create packet: DATA|METHOD|CONTROL_INFORMATION
-    std::string packet = data + "|" + methodStr + "|" + controlInfo;
+    // The control value is computed once; the frame carries its raw bytes
+    // and the text form is only for display and legacy packets
+    std::string methodStr = ErrorDetection::methodToString(method);
+    std::string controlInfo;
+    std::string controlBytes;
+    withDetectorPolicy(method, [&](auto policy) {
+        using MethodDetector = Detector<decltype(policy)>;
+        typename MethodDetector::Control control = MethodDetector::compute(data);
+        controlInfo = MethodDetector::toText(control);
+        MethodDetector::appendBytes(controlBytes, control);
+    });
 
     std::cout << "\nGenerated Packet:" << std::endl;
     std::cout << "Data: " << data << std::endl;
     std::cout << "Method: " << methodStr << std::endl;
     std::cout << "Control Information: " << controlInfo << std::endl;
-    std::cout << "Full Packet: " << packet << std::endl;
+
+    if (ring) {
+        size_t frameSize = PacketFrame::HEADER_SIZE + data.size() + controlBytes.size();
+        if (!writeToRing(*ring, method, sequence, data, controlBytes)) return false;
+        std::cout << "\nPacket written to the shared-memory ring (" << frameSize << " bytes)" << std::endl;
+        return true;
+    }
+
+    std::string packet;
+    if (legacyMode) {
+        // Create packet: DATA|METHOD|CONTROL_INFORMATION
+        packet = PacketFrame::buildLegacy(data, methodStr, controlInfo);
+        std::cout << "Full Packet: " << packet << std::endl;
+    } else {
+        PacketFrame::build(packet, method, sequence, data, controlBytes);
+        std::cout << "Frame: " << packet.size() << " bytes (" << PacketFrame::HEADER_SIZE
+                  << "-byte header + " << data.size() << "-byte payload + "
+                  << packet.size() - PacketFrame::HEADER_SIZE - data.size() << "-byte control)" << std::endl;
+    }
+
+    if (datagrams) {
+        if (packet.size() > UDP_MAX_DATAGRAM) {
+            std::cerr << "Packet too large for a datagram (" << packet.size() << " > " << UDP_MAX_DATAGRAM
+                      << " bytes)" << std::endl;
+            return false;
+        }
+        uint64_t dropped = datagrams->dropped();
+        datagrams->add(packet.data(), packet.size());
+        if (!datagrams->flush()) {
+            std::cerr << "Send failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        // The refusal of an earlier datagram (no server listening) fails
+        // this send, and this datagram is lost
+        if (datagrams->dropped() != dropped) {
+            std::cerr << "Datagram refused; is the server running with --udp?" << std::endl;
+        } else {
+            std::cout << "\nDatagram sent (" << packet.size() << " bytes)" << std::endl;
+        }
+        return true;
+    }
 
     // Send packet to server
-    ssize_t bytesSent = send(clientSocket, packet.c_str(), packet.length(), 0);
-    if (bytesSent < 0) {
+    if (!sendAll(clientSocket, packet.data(), packet.size())) {
         std::cerr << "Send failed" << std::endl;
+        return false;
+    }
+    std::cout << "\nPacket sent successfully (" << packet.size() << " bytes)" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // --legacy sends the old DATA|METHOD|CONTROL text packet instead of a
+    // binary frame.
+    // --shm writes frames into the shared-memory ring Client 2 created
+    // instead of connecting to the server.
+    // --udp sends every frame to the server as a datagram of its own.
+    // --file PATH sends that file in chunks of --chunk bytes, each checked
+    // with menu method --method, instead of asking for packets.
+    bool legacyMode = false;
+    bool shm = false;
+    bool udp = false;
+    const char* filePath = nullptr;
+    size_t chunkSize = 0;
+    int methodChoice = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--legacy") == 0) {
+            legacyMode = true;
+        } else if (std::strcmp(argv[i], "--shm") == 0) {
+            shm = true;
+        } else if (std::strcmp(argv[i], "--udp") == 0) {
+            udp = true;
+        } else if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            filePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            long value = std::atol(argv[++i]);
+            if (value < 1 || value > FILE_MAX_CHUNK) {
+                std::cerr << "Chunk size must be 1 to " << FILE_MAX_CHUNK << " bytes" << std::endl;
+                return 1;
+            }
+            chunkSize = static_cast<size_t>(value);
+        } else if (std::strcmp(argv[i], "--method") == 0 && i + 1 < argc) {
+            methodChoice = std::atoi(argv[++i]);
+            if (methodChoice < 1 || methodChoice > MENU_SIZE) {
+                std::cerr << "Method must be 1 to " << MENU_SIZE << ", as in the menu" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--legacy | --shm | --udp] [--file PATH [--chunk BYTES] [--method 1-10]]" << std::endl;
+            return 1;
+        }
+    }
+    if (legacyMode + shm + udp > 1) {
+        std::cerr << "Pick one of --legacy, --shm and --udp; the ring and datagrams carry binary frames only"
+                  << std::endl;
+        return 1;
+    }
+    if (filePath && (legacyMode || udp)) {
+        std::cerr << "--file sends binary frames over TCP or --shm" << std::endl;
+        return 1;
+    }
+    if (!filePath && (chunkSize || methodChoice)) {
+        std::cerr << "--chunk and --method only apply to --file" << std::endl;
+        return 1;
+    }
+
+    if (!KernelSelfCheck::verify()) return 1;
+
+    int clientSocket = -1;
+    ShmRing ring;
+    if (shm) {
+        std::string error;
+        if (!ring.open(SHM_RING_NAME, RingStage::SENDER, error)) {
+            std::cerr << "Attaching to the shared-memory ring failed: " << error
+                      << ". Make sure Client 2 runs with --shm." << std::endl;
+            return 1;
+        }
+        std::cout << "Attached to shared-memory ring " << SHM_RING_NAME << "!" << std::endl;
+    } else if (udp) {
+        clientSocket = createUdpSocket(0, SERVER_IP, SERVER_PORT);
+        if (clientSocket < 0) {
+            std::cerr << "UDP socket failed: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        std::cout << "Sending datagrams to UDP port " << SERVER_PORT << "!" << std::endl;
     } else {
-        std::cout << "\nPacket sent successfully (" << bytesSent << " bytes)" << std::endl;
+        // Connect to server
+        clientSocket = connectTo(SERVER_IP, SERVER_PORT);
+        if (clientSocket < 0) {
+            std::cerr << "Connection failed" << std::endl;
+            return 1;
+        }
+        std::cout << "Connected to server!" << std::endl;
+    }
+    std::cout << "\n=== Client 1: Data Sender ===" << std::endl;
+
+    if (filePath) {
+        ErrorDetectionMethod method = MENU_METHODS[(methodChoice ? methodChoice : FILE_METHOD) - 1];
+        bool sent = sendFile(clientSocket, shm ? &ring : nullptr, filePath, chunkSize ? chunkSize : FILE_CHUNK_SIZE,
+                             method);
+        if (clientSocket >= 0) close(clientSocket);
+        return sent ? 0 : 1;
+    }
+
+    // Binary frames carry their own length, so any number of them can share
+    // the connection. A legacy packet ends at EOF and is sent alone.
+    uint64_t sequence = 0;
+    std::unique_ptr<DatagramSender> datagrams;
+    if (udp) datagrams = std::make_unique<DatagramSender>(clientSocket);
+    while (sendPacket(clientSocket, shm ? &ring : nullptr, datagrams.get(), legacyMode, sequence) && !legacyMode) {
+        sequence++;
+        std::cout << "\nNext packet (empty line to finish)" << std::endl;
     }
 
     // Close socket
-    close(clientSocket);
+    if (clientSocket >= 0) close(clientSocket);
 
     return 0;
 }
@@ -1,134 +1,499 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <sstream>
 #include <sys/socket.h>
+#include <sys/signalfd.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include "error_detection.h"
+#include "detector.h"
+#include "packet_frame.h"
+#include "socket_io.h"
+#include "shm_ring.h"
+#include "udp_io.h"
 
 #define CLIENT2_PORT 8081
+#define LISTEN_BACKLOG 5
+#define MAX_MESSAGE_SIZE (64 * 1024 * 1024)
+#define RING_TIMEOUT_MS 200
+#define UDP_TIMEOUT_MS 200
+#define ACCEPT_RETRY_MS 500
 
-int main() {
-    // Create listening socket
-    int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenSocket < 0) {
-        std::cerr << "Socket creation failed" << std::endl;
-        return 1;
+// Puts back together a file Client 1 sends with --file. Every chunk that
+// passes its check is written at its offset (the frame's sequence number) as
+// it arrives, from whichever thread received it; a chunk that fails leaves a
+// hole and its offset is reported.
+class FileAssembler {
+public:
+    ~FileAssembler() {
+        if (fd_ >= 0) close(fd_);
     }
 
-    // Set socket option to reuse address
-    int opt = 1;
-    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    bool open(const char* path) {
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        path_ = path;
+        return fd_ >= 0;
+    }
 
-    // Setup server address
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(CLIENT2_PORT);
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    void record(uint64_t offset, std::string_view data, bool verified, std::ostream& out) {
+        bool written = false;
+        if (verified && fd_ >= 0) {
+            written = writeAt(offset, data);
+            if (!written) out << "Writing the chunk to " << path_ << " failed: " << std::strerror(errno) << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!verified) {
+            failed_.push_back(offset);
+            return;
+        }
+        verified_++;
+        if (written) bytes_ += data.size();
+        else if (fd_ >= 0) unwritten_++;
+    }
 
-    // Bind socket
-    if (bind(listenSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Bind failed" << std::endl;
-        close(listenSocket);
-        return 1;
+    // Summary of the chunks seen so far; nothing if there were none
+    void report(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (verified_ == 0 && failed_.empty()) return;
+        out << "\nFile chunks: " << verified_ << " verified";
+        if (fd_ >= 0) out << " (" << bytes_ << " bytes written to " << path_ << ")";
+        out << ", " << failed_.size() << " failed verification" << std::endl;
+        if (unwritten_ > 0) out << unwritten_ << " verified chunk(s) could not be written" << std::endl;
+        if (failed_.empty()) return;
+        std::sort(failed_.begin(), failed_.end());
+        out << "Failed chunk offsets:";
+        for (uint64_t offset : failed_) out << " " << offset;
+        out << std::endl;
     }
 
-    // Listen for connections
-    if (listen(listenSocket, 5) < 0) {
-        std::cerr << "Listen failed" << std::endl;
-        close(listenSocket);
-        return 1;
+private:
+    int fd_ = -1;
+    std::string path_;
+    std::mutex mutex_;
+    uint64_t verified_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t unwritten_ = 0;
+    std::vector<uint64_t> failed_;
+
+    bool writeAt(uint64_t offset, std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = pwrite(fd_, data.data(), data.size(), static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data.remove_prefix(static_cast<size_t>(n));
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
     }
+};
 
-    std::cout << "=== Client 2: Receiver + Error Checker ===" << std::endl;
-    std::cout << "Waiting for server on port " << CLIENT2_PORT << "..." << std::endl;
+FileAssembler fileAssembler;
 
-    // Accept connection from server
-    sockaddr_in serverAddr2;
-    socklen_t serverAddrLen = sizeof(serverAddr2);
-    int serverSocket = accept(listenSocket, (sockaddr*)&serverAddr2, &serverAddrLen);
-    if (serverSocket < 0) {
-        std::cerr << "Accept failed" << std::endl;
-        close(listenSocket);
-        return 1;
+// Check one packet from the server and write the result to out. Returns
+// false if the data is corrupted beyond correction.
+bool checkPacket(const Message& message, std::ostream& out) {
+    std::string_view receivedData;
+    std::string methodStr;
+    std::string incomingControl;
+    ErrorDetectionMethod method;
+    // A file chunk is too long to print; its data goes to the output file
+    bool fileChunk = message.binary && (message.frame.header.flags & PacketFrame::FLAG_FILE_CHUNK);
+
+    if (message.binary) {
+        const FrameView& frame = message.frame;
+        out << "\nReceived " << (fileChunk ? "file chunk" : "frame") << " from server (" << message.size
+            << " bytes, " << (fileChunk ? "offset " : "sequence ") << frame.header.sequence << ")" << std::endl;
+        method = frame.header.method;
+        receivedData = frame.payloadView();
+        methodStr = ErrorDetection::methodToString(method);
+        incomingControl = PacketFrame::controlToText(method, frame.controlView());
+    } else {
+        // Legacy packet: DATA|METHOD|CONTROL_INFORMATION
+        std::string_view packet = message.text;
+        out << "\nReceived packet from server: " << packet << std::endl;
+
+        LegacyPacket legacy;
+        if (!PacketFrame::parseLegacy(packet, legacy)) {
+            std::cerr << "Invalid packet format" << std::endl;
+            return false;
+        }
+        receivedData = legacy.data;
+        methodStr = std::string(legacy.method);
+        incomingControl = std::string(legacy.control);
+        method = ErrorDetection::stringToMethod(methodStr);
     }
 
-    std::cout << "Server connected!" << std::endl;
+    out << "\n=== Error Detection Results ===" << std::endl;
+    if (!fileChunk) out << "Received Data : " << receivedData << std::endl;
+    out << "Method : " << methodStr << std::endl;
+    if (!fileChunk) out << "Sent Check Bits : " << incomingControl << std::endl;
 
-    // Receive packet from server
-    char buffer[4096];
-    ssize_t bytesReceived = recv(serverSocket, buffer, sizeof(buffer) - 1, 0);
-    if (bytesReceived < 0 || bytesReceived == 0) {
-        std::cerr << "Receive failed" << std::endl;
-        close(serverSocket);
-        close(listenSocket);
-        return 1;
+    if (method == ErrorDetectionMethod::HAMMING_SECDED) {
+        // Correct single-bit errors in place instead of dropping the packet
+        std::string correctedData(receivedData);
+        HammingDecodeResult result = ErrorDetection::decodeSECDED(correctedData, incomingControl);
+        if (!fileChunk) {
+            out << "Computed Check Bits : " << ErrorDetection::calculateSECDED(correctedData) << std::endl;
+        }
+        if (result.status == HammingStatus::CLEAN) {
+            out << "Status: DATA CORRECT" << std::endl;
+        } else if (result.status == HammingStatus::CORRECTED) {
+            out << "Status: DATA CORRECTED (" << result.correctedBits
+                      << " single-bit error(s) fixed)" << std::endl;
+            if (!fileChunk) out << "Corrected Data : " << correctedData << std::endl;
+        } else {
+            out << "Status: DATA CORRUPTED (" << result.uncorrectableBlocks
+                      << " block(s) with uncorrectable errors)" << std::endl;
+        }
+        bool usable = result.status != HammingStatus::UNCORRECTABLE;
+        if (fileChunk) fileAssembler.record(message.frame.header.sequence, correctedData, usable, out);
+        return usable;
     }
 
-    buffer[bytesReceived] = '\0';
-    std::string packet(buffer);
+    // Recalculate the control value. A frame's control field is compared
+    // with it as a value, a legacy packet's control text with its text form.
+    bool isCorrect = withDetectorPolicy(method, [&](auto policy) {
+        using MethodDetector = Detector<decltype(policy)>;
+        typename MethodDetector::Control computedControl = MethodDetector::compute(receivedData);
+        std::string computedText = MethodDetector::toText(computedControl);
+        if (!fileChunk) out << "Computed Check Bits : " << computedText << std::endl;
+        if (!message.binary) return incomingControl == computedText;
+        typename MethodDetector::Control sentControl{};
+        return MethodDetector::fromBytes(message.frame.controlView(), sentControl) &&
+               sentControl == computedControl;
+    });
 
-    std::cout << "\nReceived packet from server: " << packet << std::endl;
+    out << "Status: " << (isCorrect ? "DATA CORRECT" : "DATA CORRUPTED") << std::endl;
+    if (fileChunk) fileAssembler.record(message.frame.header.sequence, receivedData, isCorrect, out);
+    return isCorrect;
+}
 
-    // Parse packet: DATA|METHOD|CONTROL_INFORMATION
-    size_t firstPipe = packet.find('|');
-    size_t secondPipe = packet.find('|', firstPipe + 1);
+// Open connections from the server, each served by its own thread. The
+// server keeps one upstream connection per worker thread, plus a short-lived
+// one for every legacy packet.
+class ConnectionSet {
+public:
+    void add(int fd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds_.insert(fd);
+    }
 
-    if (firstPipe == std::string::npos || secondPipe == std::string::npos) {
-        std::cerr << "Invalid packet format" << std::endl;
-        close(serverSocket);
-        close(listenSocket);
-        return 1;
+    // Close a connection its thread is done with. Erasing and closing under
+    // the lock keeps shutdownAll() from ever seeing an fd number that has
+    // been closed, and perhaps reused by a newer connection.
+    void closeAndRemove(int fd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds_.erase(fd);
+        close(fd);
+        if (fds_.empty()) idle_.notify_all();
     }
 
-    std::string receivedData = packet.substr(0, firstPipe);
-    std::string methodStr = packet.substr(firstPipe + 1, secondPipe - firstPipe - 1);
-    std::string incomingControl = packet.substr(secondPipe + 1);
+    // Wake every thread blocked in recv() and wait for all of them to finish
+    void shutdownAll() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (int fd : fds_) shutdown(fd, SHUT_RDWR);
+        idle_.wait(lock, [this] { return fds_.empty(); });
+    }
 
-    std::cout << "\n=== Error Detection Results ===" << std::endl;
-    std::cout << "Received Data : " << receivedData << std::endl;
-    std::cout << "Method : " << methodStr << std::endl;
-    std::cout << "Sent Check Bits : " << incomingControl << std::endl;
+private:
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::unordered_set<int> fds_;
+};
 
-    // Recalculate control information based on method
-    ErrorDetectionMethod method = ErrorDetection::stringToMethod(methodStr);
-    std::string computedControl;
+std::mutex outputMutex;
 
-    switch (method) {
-        case ErrorDetectionMethod::PARITY:
-            computedControl = ErrorDetection::calculateParity(receivedData, true);
-            break;
-        case ErrorDetectionMethod::PARITY_2D:
-            computedControl = ErrorDetection::calculate2DParity(receivedData);
-            break;
-        case ErrorDetectionMethod::CRC16:
-            computedControl = ErrorDetection::calculateCRC16(receivedData);
-            break;
-        case ErrorDetectionMethod::HAMMING:
-            computedControl = ErrorDetection::calculateHamming(receivedData);
-            break;
-        case ErrorDetectionMethod::CHECKSUM:
-            computedControl = ErrorDetection::calculateChecksum(receivedData);
+// Keep checking packets until the server closes the connection. The
+// connection leaves the set only once the thread is done with everything
+// else, so shutdownAll() returning means no packet is being checked.
+void serveConnection(int serverSocket, ConnectionSet& connections) {
+    {
+        MessageReader reader(serverSocket, MAX_MESSAGE_SIZE);
+        Message message;
+        for (;;) {
+            ReadStatus readStatus = reader.next(message);
+            if (readStatus == ReadStatus::CLOSED) break;
+            if (readStatus != ReadStatus::OK) {
+                if (!shutdownRequested()) {
+                    std::cerr << "Receive failed: " << MessageReader::statusToString(readStatus) << std::endl;
+                }
+                break;
+            }
+
+            // Results are written whole so threads never interleave lines
+            std::ostringstream out;
+            checkPacket(message, out);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << out.str() << std::flush;
+        }
+    }
+
+    connections.closeAndRemove(serverSocket);
+}
+
+// Check frames in the shared-memory ring where they lie, then free their
+// space for Client 1
+void serveRing(ShmRing& ring) {
+    Message message;
+    message.binary = true;
+    while (!shutdownRequested()) {
+        uint8_t* frame;
+        size_t capacity;
+        RingStatus status = ring.next(frame, capacity, RING_TIMEOUT_MS);
+        if (status == RingStatus::TIMEOUT) continue;
+        if (status != RingStatus::OK) break;
+
+        FrameStatus frameStatus = PacketFrame::parse(frame, capacity, message.frame, capacity);
+        if (frameStatus == FrameStatus::OK) {
+            message.size = message.frame.size();
+            std::ostringstream out;
+            checkPacket(message, out);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << out.str() << std::flush;
+        } else {
+            std::cerr << "Invalid frame in the shared-memory ring: " << PacketFrame::statusToString(frameStatus)
+                      << std::endl;
+        }
+        ring.release();
+    }
+}
+
+// Sequence numbers of one UDP source, kept apart from checksum results: a
+// datagram that never arrives is not a corrupted one. Numbering starts at the
+// first frame seen. A jump forward counts the frames skipped as missing. A
+// number already passed is a late (reordered) frame that fills one of those
+// holes, or a duplicate; the last WINDOW numbers are remembered to tell the
+// two apart, anything older counts as late.
+struct SequenceTracker {
+    static constexpr uint64_t WINDOW = 64;
+
+    uint64_t next = 0;
+    uint64_t seen = 0;          // Bit i: frame next - 1 - i arrived
+    uint64_t received = 0;
+    uint64_t missing = 0;
+    uint64_t late = 0;
+    uint64_t duplicates = 0;
+    uint64_t corrupted = 0;
+
+    void check(uint64_t sequence, std::ostream& out) {
+        if (received++ == 0) next = sequence;
+        if (sequence >= next) {
+            uint64_t skipped = sequence - next;
+            uint64_t shift = skipped + 1;
+            seen = (shift >= WINDOW ? 0 : seen << shift) | 1;
+            next = sequence + 1;
+            missing += skipped;
+            if (skipped == 0) {
+                out << "Sequence : in order" << std::endl;
+            } else {
+                out << "Sequence : GAP (" << skipped << " frame(s) missing before this one)" << std::endl;
+            }
+            return;
+        }
+
+        uint64_t age = next - 1 - sequence;
+        if (age < WINDOW && (seen & (1ULL << age))) {
+            duplicates++;
+            out << "Sequence : DUPLICATE" << std::endl;
+            return;
+        }
+        if (age < WINDOW) seen |= 1ULL << age;
+        late++;
+        if (missing > 0) missing--;
+        out << "Sequence : LATE (expected " << next << ")" << std::endl;
+    }
+};
+
+// Check datagrams as recvmmsg() delivers them, in batches. The server sends
+// every Client 1 stream from a socket of its own, so each source address is
+// one sequence.
+void serveDatagrams(int fd) {
+    DatagramReceiver receiver(fd, true);
+    std::unordered_map<uint64_t, SequenceTracker> sources;
+    std::vector<Datagram> batch;
+    Message message;
+    message.binary = true;
+    while (!shutdownRequested()) {
+        if (!receiver.receive(batch)) {
+            std::cerr << "UDP receive failed: " << std::strerror(errno) << std::endl;
             break;
-        default:
-            std::cerr << "Unknown method" << std::endl;
-            close(serverSocket);
+        }
+        std::ostringstream out;
+        for (const Datagram& datagram : batch) {
+            FrameStatus frameStatus = PacketFrame::parse(datagram.data, datagram.size, message.frame, datagram.size);
+            if (frameStatus != FrameStatus::OK) {
+                std::cerr << "Invalid datagram: " << PacketFrame::statusToString(frameStatus) << std::endl;
+                continue;
+            }
+            message.size = message.frame.size();
+            SequenceTracker& tracker = sources[peerKey(datagram.from)];
+            if (!checkPacket(message, out)) tracker.corrupted++;
+            tracker.check(message.frame.header.sequence, out);
+        }
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << out.str() << std::flush;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(outputMutex);
+    for (const auto& source : sources) {
+        const SequenceTracker& tracker = source.second;
+        std::cout << "\nUDP stream from port " << (source.first & 0xFFFF) << ": " << tracker.received
+                  << " frame(s) received, " << tracker.corrupted << " corrupted, " << tracker.missing
+                  << " missing, " << tracker.late << " late, " << tracker.duplicates << " duplicate" << std::endl;
+    }
+    if (receiver.truncated() > 0) {
+        std::cout << receiver.truncated() << " truncated datagram(s) dropped" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // --shm also receives frames through a shared-memory ring (see
+    // shm_ring.h) that Client 1 and the server attach to.
+    // --udp also receives frames as datagrams on UDP port CLIENT2_PORT.
+    // --output PATH writes the verified chunks of a file Client 1 sends
+    // with --file there.
+    bool shm = false;
+    bool udp = false;
+    const char* outputPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--shm") == 0) {
+            shm = true;
+        } else if (std::strcmp(argv[i], "--udp") == 0) {
+            udp = true;
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--shm] [--udp] [--output PATH]" << std::endl;
+            return 1;
+        }
+    }
+    if (outputPath && !fileAssembler.open(outputPath)) {
+        std::cerr << "Cannot write " << outputPath << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    if (!KernelSelfCheck::verify()) return 1;
+
+    // Block SIGINT/SIGTERM in every thread; the main thread receives them
+    // through a signalfd it polls together with the listening socket, so a
+    // signal is never lost between a check and a blocking accept()
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (signalFd < 0) {
+        std::cerr << "signalfd creation failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // Create listening socket
+    int listenSocket = createListenSocket(CLIENT2_PORT, LISTEN_BACKLOG);
+    if (listenSocket < 0 || !setNonBlocking(listenSocket)) {
+        std::cerr << "Listen on port " << CLIENT2_PORT << " failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== Client 2: Receiver + Error Checker ===" << std::endl;
+    std::cout << "Waiting for server on port " << CLIENT2_PORT << "..." << std::endl;
+
+    ShmRing ring;
+    if (shm) {
+        std::string error;
+        if (!ring.open(SHM_RING_NAME, RingStage::RECEIVER, error)) {
+            std::cerr << "Creating the shared-memory ring failed: " << error << std::endl;
+            close(listenSocket);
+            return 1;
+        }
+        std::cout << "Receiving frames through shared-memory ring " << SHM_RING_NAME << std::endl;
+    }
+    int udpSocket = -1;
+    if (udp) {
+        udpSocket = createUdpSocket(CLIENT2_PORT, nullptr, 0, UDP_TIMEOUT_MS);
+        if (udpSocket < 0) {
+            std::cerr << "UDP socket on port " << CLIENT2_PORT << " failed: " << std::strerror(errno) << std::endl;
             close(listenSocket);
             return 1;
+        }
+        std::cout << "Receiving datagrams on UDP port " << CLIENT2_PORT << std::endl;
     }
 
-    std::cout << "Computed Check Bits : " << computedControl << std::endl;
+    std::thread ringThread;
+    if (shm) ringThread = std::thread(serveRing, std::ref(ring));
+    std::thread udpThread;
+    if (udp) udpThread = std::thread(serveDatagrams, udpSocket);
+
+    // Serve server connections until SIGINT/SIGTERM. After an accept error
+    // that does not go away by itself (e.g. out of descriptors) only the
+    // signal is watched for ACCEPT_RETRY_MS, so the loop does not spin.
+    ConnectionSet connections;
+    pollfd watched[2] = {{signalFd, POLLIN, 0}, {listenSocket, POLLIN, 0}};
+    int watchedCount = 2;
+    bool acceptFailing = false;
+    for (;;) {
+        int ready = poll(watched, watchedCount, watchedCount == 2 ? -1 : ACCEPT_RETRY_MS);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (ready > 0 && (watched[0].revents & POLLIN)) break;
+        watchedCount = 2;
+        if (ready <= 0 || !(watched[1].revents & POLLIN)) continue;
+
+        sockaddr_in serverAddr;
+        socklen_t serverAddrLen = sizeof(serverAddr);
+        int serverSocket = accept4(listenSocket, (sockaddr*)&serverAddr, &serverAddrLen, SOCK_CLOEXEC);
+        if (serverSocket < 0) {
+            // Gone before it was accepted, or interrupted: nothing to wait for
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR) continue;
+            if (!acceptFailing) {
+                std::cerr << "Accept failed: " << std::strerror(errno) << ", retrying every "
+                          << ACCEPT_RETRY_MS << " ms" << std::endl;
+            }
+            acceptFailing = true;
+            watchedCount = 1;
+            continue;
+        }
+        acceptFailing = false;
+
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << "Server connected!" << std::endl;
+        }
 
-    // Compare control information
-    bool isCorrect = (incomingControl == computedControl);
+        connections.add(serverSocket);
+        std::thread(serveConnection, serverSocket, std::ref(connections)).detach();
+    }
 
-    std::cout << "Status: " << (isCorrect ? "DATA CORRECT" : "DATA CORRUPTED") << std::endl;
+    // The ring and UDP threads check this between receives
+    shutdownRequested() = true;
+    connections.shutdownAll();
+    if (ringThread.joinable()) ringThread.join();
+    ring.close();
+    if (udpThread.joinable()) udpThread.join();
+    if (udpSocket >= 0) close(udpSocket);
 
-    // Close sockets
-    close(serverSocket);
+    // Close listening socket
     close(listenSocket);
+    close(signalFd);
 
+    fileAssembler.report(std::cout);
+    std::cout << "\nClient 2 finished." << std::endl;
     return 0;
 }
-
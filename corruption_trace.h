@@ -0,0 +1,285 @@
+#ifndef CORRUPTION_TRACE_H
+#define CORRUPTION_TRACE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "error_injection.h"
+
+// Binary trace of every corruption the server applies, for reproducing a run.
+// All integers are LEB128 varints:
+//   header   "EDCT", version byte, master seed, channel spec length, channel spec
+//   record   stream, sequence, payload length, errors, edit count, edits
+//   edit     op byte, offset, then a value byte for XOR/SET/INSERT/FILL and a
+//            length for FILL
+// A stream is one Client 1 connection, numbered in the order the server
+// accepted them; records of a stream appear in the order its packets were
+// corrupted. A bit flip costs 3-6 bytes.
+
+struct TraceRecord {
+    uint64_t stream;
+    uint64_t sequence;
+    uint64_t length;        // Payload length before corruption
+    uint64_t errors;        // What the channel model reported
+    size_t firstEdit;       // Index into CorruptionTrace::edits()
+    size_t editCount;
+};
+
+class CorruptionTrace {
+public:
+    static constexpr uint8_t VERSION = 1;
+
+    static void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    static void encodeHeader(std::string& out, uint64_t seed, const std::string& channel) {
+        out.append("EDCT", 4);
+        out.push_back(static_cast<char>(VERSION));
+        putVarint(out, seed);
+        putVarint(out, channel.size());
+        out.append(channel);
+    }
+
+    static void encodeRecord(std::string& out, uint64_t stream, uint64_t sequence, uint64_t length,
+                             uint64_t errors, const CorruptionEdits& edits) {
+        putVarint(out, stream);
+        putVarint(out, sequence);
+        putVarint(out, length);
+        putVarint(out, errors);
+        putVarint(out, edits.size());
+        for (const CorruptionEdit& edit : edits) {
+            out.push_back(static_cast<char>(edit.op));
+            putVarint(out, edit.offset);
+            if (edit.op == EditOp::XOR || edit.op == EditOp::SET ||
+                edit.op == EditOp::INSERT || edit.op == EditOp::FILL) {
+                out.push_back(static_cast<char>(edit.value));
+            }
+            if (edit.op == EditOp::FILL) putVarint(out, edit.length);
+        }
+    }
+
+    // Read a whole trace file; on failure error says why
+    bool load(const std::string& path, std::string& error) {
+        std::string file;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        char chunk[1 << 16];
+        ssize_t n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) file.append(chunk, static_cast<size_t>(n));
+        ::close(fd);
+        if (n < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        return parse(file, error);
+    }
+
+    bool parse(const std::string& file, std::string& error) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(file.data());
+        const uint8_t* end = p + file.size();
+        uint64_t channelLength;
+        if (file.size() < 5 || std::memcmp(p, "EDCT", 4) != 0) {
+            error = "not a corruption trace";
+            return false;
+        }
+        if (p[4] != VERSION) {
+            error = "unsupported trace version";
+            return false;
+        }
+        p += 5;
+        if (!getVarint(p, end, seed_) || !getVarint(p, end, channelLength) ||
+            channelLength > static_cast<uint64_t>(end - p)) {
+            error = "truncated header";
+            return false;
+        }
+        channel_.assign(reinterpret_cast<const char*>(p), channelLength);
+        p += channelLength;
+
+        while (p < end) {
+            TraceRecord record;
+            uint64_t count;
+            if (!getVarint(p, end, record.stream) || !getVarint(p, end, record.sequence) ||
+                !getVarint(p, end, record.length) || !getVarint(p, end, record.errors) ||
+                !getVarint(p, end, count)) {
+                error = "truncated record";
+                return false;
+            }
+            record.firstEdit = edits_.size();
+            record.editCount = count;
+            for (uint64_t i = 0; i < count; i++) {
+                CorruptionEdit edit = {EditOp::XOR, 0, 0, 1};
+                uint64_t offset;
+                uint64_t length = 1;
+                if (p >= end) break;
+                edit.op = static_cast<EditOp>(*p++);
+                if (edit.op > EditOp::FILL || !getVarint(p, end, offset)) break;
+                if (edit.op == EditOp::XOR || edit.op == EditOp::SET ||
+                    edit.op == EditOp::INSERT || edit.op == EditOp::FILL) {
+                    if (p >= end) break;
+                    edit.value = *p++;
+                }
+                if (edit.op == EditOp::FILL && !getVarint(p, end, length)) break;
+                edit.offset = static_cast<uint32_t>(offset);
+                edit.length = static_cast<uint32_t>(length);
+                edits_.push_back(edit);
+            }
+            if (edits_.size() != record.firstEdit + count) {
+                error = "truncated edit";
+                return false;
+            }
+            streams_[record.stream].push_back(records_.size());
+            records_.push_back(record);
+        }
+        return true;
+    }
+
+    uint64_t seed() const { return seed_; }
+    const std::string& channel() const { return channel_; }
+    const std::vector<TraceRecord>& records() const { return records_; }
+    const std::vector<CorruptionEdit>& edits() const { return edits_; }
+
+    // Indexes into records() of one stream's packets, in order
+    const std::vector<size_t>& stream(uint64_t id) const {
+        static const std::vector<size_t> none;
+        auto it = streams_.find(id);
+        return it == streams_.end() ? none : it->second;
+    }
+
+private:
+    uint64_t seed_ = 0;
+    std::string channel_;
+    std::vector<TraceRecord> records_;
+    std::vector<CorruptionEdit> edits_;
+    std::unordered_map<uint64_t, std::vector<size_t>> streams_;
+};
+
+// Buffered appender shared by all worker threads. Records are encoded
+// outside the lock and written out in FLUSH_SIZE blocks.
+class TraceWriter {
+public:
+    static constexpr size_t FLUSH_SIZE = 1 << 20;
+
+    ~TraceWriter() { close(); }
+
+    bool open(const std::string& path, uint64_t seed, const std::string& channel) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) return false;
+        buffer_.reserve(FLUSH_SIZE + 4096);
+        CorruptionTrace::encodeHeader(buffer_, seed, channel);
+        return true;
+    }
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    void append(uint64_t stream, uint64_t sequence, uint64_t length, uint64_t errors,
+                const CorruptionEdits& edits) {
+        thread_local std::string record;
+        record.clear();
+        CorruptionTrace::encodeRecord(record, stream, sequence, length, errors, edits);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_.append(record);
+        if (buffer_.size() >= FLUSH_SIZE) writeBuffer();
+    }
+
+    // Write out buffered records and close; returns false if any write failed
+    bool close() {
+        if (fd_ < 0) return !failed_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        writeBuffer();
+        ::close(fd_);
+        fd_ = -1;
+        return !failed_;
+    }
+
+private:
+    int fd_ = -1;
+    bool failed_ = false;
+    std::mutex mutex_;
+    std::string buffer_;
+
+    void writeBuffer() {
+        const char* p = buffer_.data();
+        size_t left = buffer_.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                failed_ = true;
+                break;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        buffer_.clear();
+    }
+};
+
+// Channel model that re-applies a recorded stream's corruptions, packet by
+// packet, instead of drawing new ones. Packets beyond the end of the recording
+// pass through untouched.
+class ReplayChannel : public ChannelModel {
+public:
+    ReplayChannel(std::shared_ptr<const CorruptionTrace> trace, uint64_t stream)
+        : ChannelModel(0), trace_(std::move(trace)), stream_(stream) {}
+
+    size_t apply(char* data, size_t& length, size_t capacity, CorruptionEdits* edits = nullptr) override {
+        bits_ += static_cast<uint64_t>(length) * 8;
+        const std::vector<size_t>& records = trace_->stream(stream_);
+        if (next_ >= records.size()) return 0;
+
+        const TraceRecord& record = trace_->records()[records[next_++]];
+        const CorruptionEdit* first = trace_->edits().data() + record.firstEdit;
+        ErrorInjection::applyEdits(data, length, capacity, first, record.editCount);
+        if (edits) edits->insert(edits->end(), first, first + record.editCount);
+        errors_ += record.errors;
+        return record.errors;
+    }
+
+    std::string describe() const override { return "replay of " + trace_->channel(); }
+
+    bool passesClean(size_t length) override {
+        const std::vector<size_t>& records = trace_->stream(stream_);
+        if (next_ < records.size()) {
+            const TraceRecord& record = trace_->records()[records[next_]];
+            if (record.editCount > 0 || record.errors > 0) return false;
+            next_++;
+        }
+        bits_ += static_cast<uint64_t>(length) * 8;
+        return true;
+    }
+
+private:
+    std::shared_ptr<const CorruptionTrace> trace_;
+    uint64_t stream_;
+    size_t next_ = 0;
+
+    void restart() override { next_ = 0; }
+};
+
+#endif // CORRUPTION_TRACE_H
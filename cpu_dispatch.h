@@ -0,0 +1,107 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <iostream>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#define CPU_DISPATCH_X86 1
+#endif
+
+// Instruction set levels the detector kernels are built for. Each level
+// includes the ones below it:
+//   SSE42   SSSE3, SSE4.2, POPCNT and PCLMULQDQ
+//   AVX2    AVX2 with OS support for the YMM registers
+//   AVX512  AVX-512 F, BW and VL with OS support for the ZMM registers
+enum class CpuLevel : int {
+    SCALAR = 0,
+    SSE42 = 1,
+    AVX2 = 2,
+    AVX512 = 3
+};
+
+// Picks the instruction set level once per process. Kernels bind their
+// function pointers to the best implementation for level(); setting
+// EDC_CPU_LEVEL=scalar|sse4.2|avx2|avx512 caps it, e.g. to rule out a
+// suspect code path or to benchmark the slower ones. A cap above what the
+// CPU supports is ignored.
+class CpuDispatch {
+public:
+    static constexpr const char* ENVIRONMENT_VARIABLE = "EDC_CPU_LEVEL";
+
+    // Highest level this CPU and OS support
+    static CpuLevel detected() {
+        static const CpuLevel level = detect();
+        return level;
+    }
+
+    // Level the kernels use
+    static CpuLevel level() {
+        static const CpuLevel level = [] {
+            CpuLevel cap = CpuLevel::AVX512;
+            const char* value = std::getenv(ENVIRONMENT_VARIABLE);
+            if (value && *value && !parseLevel(value, cap)) {
+                std::cerr << "Ignoring invalid " << ENVIRONMENT_VARIABLE << "=" << value
+                          << " (expected scalar, sse4.2, avx2 or avx512)" << std::endl;
+                cap = CpuLevel::AVX512;
+            }
+            return cap < detected() ? cap : detected();
+        }();
+        return level;
+    }
+
+    static const char* levelToString(CpuLevel level) {
+        switch (level) {
+            case CpuLevel::SCALAR: return "scalar";
+            case CpuLevel::SSE42: return "sse4.2";
+            case CpuLevel::AVX2: return "avx2";
+            case CpuLevel::AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    static bool parseLevel(const char* text, CpuLevel& level) {
+        for (CpuLevel candidate : {CpuLevel::SCALAR, CpuLevel::SSE42, CpuLevel::AVX2, CpuLevel::AVX512}) {
+            if (strcasecmp(text, levelToString(candidate)) == 0) {
+                level = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static CpuLevel detect() {
+#ifdef CPU_DISPATCH_X86
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return CpuLevel::SCALAR;
+        const unsigned sse42 = bit_SSSE3 | bit_SSE4_2 | bit_POPCNT | bit_PCLMUL;
+        if ((ecx & sse42) != sse42) return CpuLevel::SCALAR;
+
+        // Wide registers also need the OS to save them on context switches
+        uint64_t xcr0 = 0;
+        if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+            uint32_t low, high;
+            __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+            xcr0 = (static_cast<uint64_t>(high) << 32) | low;
+        }
+        bool ymm = (xcr0 & 0x06) == 0x06;
+        bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+        if (__get_cpuid_max(0, nullptr) < 7) return CpuLevel::SSE42;
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (!ymm || !(ebx & bit_AVX2)) return CpuLevel::SSE42;
+        const unsigned avx512 = bit_AVX512F | bit_AVX512BW | bit_AVX512VL;
+        if (!zmm || (ebx & avx512) != avx512) return CpuLevel::AVX2;
+        return CpuLevel::AVX512;
+#else
+        return CpuLevel::SCALAR;
+#endif
+    }
+};
+
+#endif // CPU_DISPATCH_H
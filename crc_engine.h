@@ -0,0 +1,253 @@
+#ifndef CRC_ENGINE_H
+#define CRC_ENGINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "cpu_dispatch.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CRC_ENGINE_X86 1
+#endif
+
+// Generic table-driven CRC over width, polynomial, initial value, input/output
+// reflection and final XOR (the usual Rocksoft parameter model). Every variant
+// uses slicing-by-8 tables generated at compile time; reflected variants also
+// get a PCLMULQDQ folding kernel on large buffers, and CRC-32C uses the SSE4.2
+// crc32 instruction. Accelerated paths are picked once at runtime (see
+// cpu_dispatch.h).
+template <int Width, uint64_t Poly, uint64_t Init, bool RefIn, bool RefOut, uint64_t XorOut>
+class CrcEngine {
+    static_assert(Width == 16 || Width == 32 || Width == 64, "unsupported CRC width");
+
+public:
+    using Value = std::conditional_t<Width == 16, uint16_t,
+                  std::conditional_t<Width == 32, uint32_t, uint64_t>>;
+    using Table = std::array<std::array<Value, 256>, 8>;
+    using UpdateFn = Value (*)(Value, const uint8_t*, size_t);
+
+    static constexpr int WIDTH = Width;
+    static constexpr uint64_t MASK = (Width == 64) ? ~0ULL : ((1ULL << Width) - 1);
+
+    static constexpr uint64_t reflect(uint64_t value, int bits) {
+        uint64_t result = 0;
+        for (int i = 0; i < bits; i++) {
+            if (value & (1ULL << i)) result |= 1ULL << (bits - 1 - i);
+        }
+        return result;
+    }
+
+    // Slicing tables: tables[0] is the classic byte table, tables[k][b] is
+    // the CRC of byte b followed by k zero bytes.
+    static constexpr Table makeTables() {
+        Table tables{};
+        for (int b = 0; b < 256; b++) {
+            uint64_t crc = 0;
+            if (RefIn) {
+                const uint64_t poly = reflect(Poly, Width);
+                crc = static_cast<uint64_t>(b);
+                for (int i = 0; i < 8; i++) {
+                    crc = (crc & 1) ? (crc >> 1) ^ poly : (crc >> 1);
+                }
+            } else {
+                crc = static_cast<uint64_t>(b) << (Width - 8);
+                for (int i = 0; i < 8; i++) {
+                    crc = (crc >> (Width - 1)) & 1 ? (crc << 1) ^ Poly : (crc << 1);
+                }
+            }
+            tables[0][b] = static_cast<Value>(crc & MASK);
+        }
+        for (int k = 1; k < 8; k++) {
+            for (int b = 0; b < 256; b++) {
+                uint64_t prev = tables[k - 1][b];
+                uint64_t next = RefIn ? (prev >> 8) ^ tables[0][prev & 0xFF]
+                                      : (prev << 8) ^ tables[0][(prev >> (Width - 8)) & 0xFF];
+                tables[k][b] = static_cast<Value>(next & MASK);
+            }
+        }
+        return tables;
+    }
+
+    static const Table& tables() {
+        static constexpr Table TABLES = makeTables();
+        return TABLES;
+    }
+
+    static constexpr Value initial() {
+        return static_cast<Value>(RefIn ? reflect(Init, Width) : Init);
+    }
+
+    static constexpr Value finalize(Value crc) {
+        uint64_t out = crc;
+        if (RefIn != RefOut) out = reflect(out, Width);
+        return static_cast<Value>((out ^ XorOut) & MASK);
+    }
+
+    // Portable slicing-by-8 update over the raw CRC register
+    static Value updateTable(Value crc, const uint8_t* data, size_t length) {
+        const Table& t = tables();
+        uint64_t reg = crc;
+
+        // Fold the register into the leading bytes of each 8-byte group and
+        // look up all eight bytes independently
+        while (length >= 8) {
+            uint8_t b[8];
+            std::memcpy(b, data, 8);
+            for (int i = 0; i < Width / 8; i++) {
+                b[i] ^= RefIn ? static_cast<uint8_t>(reg >> (8 * i))
+                              : static_cast<uint8_t>(reg >> (Width - 8 - 8 * i));
+            }
+            reg = t[7][b[0]] ^ t[6][b[1]] ^ t[5][b[2]] ^ t[4][b[3]] ^
+                  t[3][b[4]] ^ t[2][b[5]] ^ t[1][b[6]] ^ t[0][b[7]];
+            data += 8;
+            length -= 8;
+        }
+
+        // Byte-at-a-time tail
+        while (length--) {
+            if (RefIn) {
+                reg = (reg >> 8) ^ t[0][(reg ^ *data++) & 0xFF];
+            } else {
+                reg = ((reg << 8) ^ t[0][((reg >> (Width - 8)) ^ *data++) & 0xFF]) & MASK;
+            }
+        }
+        return static_cast<Value>(reg);
+    }
+
+#ifdef CRC_ENGINE_X86
+    // x^n mod P, bit-reflected into a 64-bit lane for carry-less multiplies
+    static constexpr uint64_t foldConstant(int n) {
+        uint64_t r = 1;
+        for (int i = 0; i < n; i++) {
+            bool top = (r >> (Width - 1)) & 1;
+            r = (r << 1) & MASK;
+            if (top) r ^= Poly;
+        }
+        return reflect(r, 64);
+    }
+
+    // Multiply both 64-bit halves of acc by x^distance (mod P) and add next.
+    // A reflected 64x64 clmul yields the product times x, hence the -1.
+    __attribute__((target("pclmul,sse2")))
+    static __m128i fold(__m128i acc, __m128i k, __m128i next) {
+        __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+        __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+        return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+    }
+
+    // PCLMULQDQ folding for reflected CRCs: four 128-bit accumulators fold
+    // 64 bytes per step, then collapse into one 128-bit remainder whose CRC
+    // (with a zero register) is the CRC of everything folded so far.
+    __attribute__((target("pclmul,sse2")))
+    static Value updateFolded(Value crc, const uint8_t* data, size_t length) {
+        if (length < 64) return updateTable(crc, data, length);
+
+        const __m128i k512 = _mm_set_epi64x(static_cast<long long>(foldConstant(512 - 1)),
+                                            static_cast<long long>(foldConstant(512 + 64 - 1)));
+        const __m128i k128 = _mm_set_epi64x(static_cast<long long>(foldConstant(128 - 1)),
+                                            static_cast<long long>(foldConstant(128 + 64 - 1)));
+        auto load = [](const uint8_t* p) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        };
+
+        __m128i x0 = _mm_xor_si128(load(data), _mm_cvtsi64_si128(static_cast<long long>(crc)));
+        __m128i x1 = load(data + 16);
+        __m128i x2 = load(data + 32);
+        __m128i x3 = load(data + 48);
+        data += 64;
+        length -= 64;
+
+        while (length >= 64) {
+            x0 = fold(x0, k512, load(data));
+            x1 = fold(x1, k512, load(data + 16));
+            x2 = fold(x2, k512, load(data + 32));
+            x3 = fold(x3, k512, load(data + 48));
+            data += 64;
+            length -= 64;
+        }
+
+        __m128i x = fold(x0, k128, x1);
+        x = fold(x, k128, x2);
+        x = fold(x, k128, x3);
+        while (length >= 16) {
+            x = fold(x, k128, load(data));
+            data += 16;
+            length -= 16;
+        }
+
+        uint8_t remainder[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(remainder), x);
+        Value reg = updateTable(0, remainder, sizeof(remainder));
+        return updateTable(reg, data, length);
+    }
+
+    // CRC-32C via the SSE4.2 crc32 instruction
+    __attribute__((target("sse4.2")))
+    static Value updateCrc32cHardware(Value crc, const uint8_t* data, size_t length) {
+        uint64_t reg = crc;
+        while (length >= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            reg = _mm_crc32_u64(reg, word);
+            data += 8;
+            length -= 8;
+        }
+        while (length--) {
+            reg = _mm_crc32_u8(static_cast<uint32_t>(reg), *data++);
+        }
+        return static_cast<Value>(reg);
+    }
+#endif
+
+    // Accelerated kernel for an instruction set level, or nullptr for
+    // table-only
+    static UpdateFn acceleratedUpdate(CpuLevel level) {
+#ifdef CRC_ENGINE_X86
+        if (level >= CpuLevel::SSE42) {
+            if constexpr (Width == 32 && Poly == 0x1EDC6F41 && RefIn) return &updateCrc32cHardware;
+            if constexpr (RefIn) return &updateFolded;
+        }
+#endif
+        (void)level;
+        return nullptr;
+    }
+
+    // Kernel for the level the process runs at
+    static UpdateFn acceleratedUpdate() {
+        static const UpdateFn fn = acceleratedUpdate(CpuDispatch::level());
+        return fn;
+    }
+
+    // Continue a CRC over another block of bytes (raw register, no final XOR)
+    static Value update(Value crc, const uint8_t* data, size_t length) {
+        if (length >= 64) {
+            if (UpdateFn fn = acceleratedUpdate()) return fn(crc, data, length);
+        }
+        return updateTable(crc, data, length);
+    }
+
+    static Value compute(const uint8_t* data, size_t length) {
+        return finalize(update(initial(), data, length));
+    }
+};
+
+// CRC-16 with polynomial 0x8005, initial value 0xFFFF, MSB-first, no final
+// XOR; matches the original bit-serial calculateCRC16 loop
+using Crc16Engine = CrcEngine<16, 0x8005, 0xFFFF, false, false, 0>;
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+using Crc16CcittEngine = CrcEngine<16, 0x1021, 0xFFFF, false, false, 0>;
+
+// CRC-32 as used by Ethernet, zlib and PNG
+using Crc32Engine = CrcEngine<32, 0x04C11DB7, 0xFFFFFFFF, true, true, 0xFFFFFFFF>;
+
+// CRC-32C (Castagnoli) as used by iSCSI and SCTP
+using Crc32cEngine = CrcEngine<32, 0x1EDC6F41, 0xFFFFFFFF, true, true, 0xFFFFFFFF>;
+
+// CRC-64/XZ (ECMA-182 polynomial, reflected)
+using Crc64Engine = CrcEngine<64, 0x42F0E1EBA9EA3693ULL, ~0ULL, true, true, ~0ULL>;
+
+#endif // CRC_ENGINE_H
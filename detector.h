@@ -0,0 +1,252 @@
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <array>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include "error_detection.h"
+
+// Compile-time specialized detectors. A policy names the method, its
+// streaming state and the type of its control value; Detector<Policy>
+// computes that value without formatting it, so verifying a payload against
+// an integer control value is one integer compare. Text is produced only for
+// display, by toText().
+//
+// Integer methods use the smallest unsigned type that holds their value.
+// 2D parity and SECDED grow with the payload; their control value is the
+// byte string a binary frame carries (see packet_frame.h).
+
+// Control value of a fixed-width method, big-endian on the wire
+template <ErrorDetectionMethod Method, typename StateType, int Width, int Digits>
+struct IntegerPolicy {
+    static constexpr ErrorDetectionMethod METHOD = Method;
+    static constexpr int WIDTH = Width;     // Bytes in a binary frame
+    using State = StateType;
+    using Control = decltype(std::declval<const StateType&>().finalize());
+
+    static void finish(State& state, Control& control) {
+        control = state.finalize();
+        state.reset();
+    }
+
+    static std::string toText(Control control) {
+        return ErrorDetection::toHex(control, Digits);
+    }
+
+    static void appendBytes(std::string& out, Control control) {
+        for (int i = Width - 1; i >= 0; i--) {
+            out.push_back(static_cast<char>(static_cast<uint64_t>(control) >> (8 * i)));
+        }
+    }
+
+    static bool fromBytes(std::string_view bytes, Control& control) {
+        if (bytes.size() != Width) return false;
+        uint64_t value = 0;
+        for (char c : bytes) value = (value << 8) | static_cast<uint8_t>(c);
+        control = static_cast<Control>(value);
+        return true;
+    }
+};
+
+struct ParityPolicy {
+    static constexpr ErrorDetectionMethod METHOD = ErrorDetectionMethod::PARITY;
+    static constexpr int WIDTH = 1;
+    using State = ParityStream;
+    using Control = uint8_t;
+
+    static void finish(State& state, Control& control) {
+        control = state.finalize() ? 1 : 0;
+        state.reset();
+    }
+
+    static std::string toText(Control control) { return control ? "1" : "0"; }
+
+    static void appendBytes(std::string& out, Control control) {
+        out.push_back(static_cast<char>(control));
+    }
+
+    static bool fromBytes(std::string_view bytes, Control& control) {
+        if (bytes.size() != 1) return false;
+        control = bytes[0] != 0 ? 1 : 0;
+        return true;
+    }
+};
+
+// Row and column parity nibbles, as produced by calculate2DParity
+class Parity2DState {
+public:
+    void update(const uint8_t* data, size_t length) {
+        matrix_.update(data, length);
+        length_ += length;
+    }
+
+    void finish(std::string& control) {
+        control.clear();
+        if (length_ == 0) {
+            control.assign("0|0");
+            return;
+        }
+        matrix_.finish(rowParity_, colParity_);
+        ErrorDetection::appendNibbles(control, rowParity_);
+        control.push_back('|');
+        ErrorDetection::appendNibbles(control, colParity_);
+        length_ = 0;
+    }
+
+    void reset() {
+        matrix_.reset();
+        length_ = 0;
+    }
+
+private:
+    ParityMatrix matrix_;
+    PackedBits rowParity_;
+    PackedBits colParity_;
+    size_t length_ = 0;
+};
+
+struct Parity2DPolicy {
+    static constexpr ErrorDetectionMethod METHOD = ErrorDetectionMethod::PARITY_2D;
+    static constexpr int WIDTH = 0;
+    using State = Parity2DState;
+    using Control = std::string;
+
+    static void finish(State& state, Control& control) { state.finish(control); }
+    static std::string toText(const Control& control) { return control; }
+    static void appendBytes(std::string& out, const Control& control) { out.append(control); }
+
+    static bool fromBytes(std::string_view bytes, Control& control) {
+        control.assign(bytes.data(), bytes.size());
+        return true;
+    }
+};
+
+// SECDED check bits of every payload byte, one raw byte each
+class SecdedState {
+public:
+    void update(const uint8_t* data, size_t length) {
+        const std::array<uint8_t, 256>& table = SecdedStream::checkBits();
+        size_t start = bytes_.size();
+        bytes_.resize(start + length);
+        for (size_t i = 0; i < length; i++) {
+            bytes_[start + i] = static_cast<char>(table[data[i]]);
+        }
+    }
+
+    void finish(std::string& control) {
+        control.swap(bytes_);
+        bytes_.clear();
+    }
+
+    void reset() { bytes_.clear(); }
+
+private:
+    std::string bytes_;
+};
+
+struct SecdedPolicy {
+    static constexpr ErrorDetectionMethod METHOD = ErrorDetectionMethod::HAMMING_SECDED;
+    static constexpr int WIDTH = 0;
+    using State = SecdedState;
+    using Control = std::string;
+
+    static void finish(State& state, Control& control) { state.finish(control); }
+
+    static std::string toText(const Control& control) {
+        std::string text;
+        for (char c : control) ErrorDetection::appendHex(text, static_cast<uint8_t>(c), 2);
+        return text;
+    }
+
+    static void appendBytes(std::string& out, const Control& control) { out.append(control); }
+
+    static bool fromBytes(std::string_view bytes, Control& control) {
+        control.assign(bytes.data(), bytes.size());
+        return true;
+    }
+};
+
+using Crc16Policy = IntegerPolicy<ErrorDetectionMethod::CRC16, CrcStream<Crc16Engine>, 2, 4>;
+using HammingPolicy = IntegerPolicy<ErrorDetectionMethod::HAMMING, HammingStream, 8, 4>;
+using ChecksumPolicy = IntegerPolicy<ErrorDetectionMethod::CHECKSUM, ChecksumStream, 2, 4>;
+using Crc16CcittPolicy = IntegerPolicy<ErrorDetectionMethod::CRC16_CCITT, CrcStream<Crc16CcittEngine>, 2, 4>;
+using Crc32Policy = IntegerPolicy<ErrorDetectionMethod::CRC32, CrcStream<Crc32Engine>, 4, 8>;
+using Crc32cPolicy = IntegerPolicy<ErrorDetectionMethod::CRC32C, CrcStream<Crc32cEngine>, 4, 8>;
+using Crc64Policy = IntegerPolicy<ErrorDetectionMethod::CRC64, CrcStream<Crc64Engine>, 8, 16>;
+
+// Every policy, in ErrorDetectionMethod order
+using DetectorPolicies = std::tuple<ParityPolicy, Parity2DPolicy, Crc16Policy, HammingPolicy, ChecksumPolicy,
+                                    Crc16CcittPolicy, Crc32Policy, Crc32cPolicy, Crc64Policy, SecdedPolicy>;
+
+template <typename Policy>
+class Detector {
+public:
+    using Control = typename Policy::Control;
+    static constexpr ErrorDetectionMethod METHOD = Policy::METHOD;
+
+    void update(const uint8_t* data, size_t length) { state_.update(data, length); }
+
+    void update(std::string_view data) {
+        update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    // Write the control value and reset for the next payload. Reusing the
+    // same Control keeps variable-length values from reallocating.
+    void finalize(Control& control) { Policy::finish(state_, control); }
+
+    Control finalize() {
+        Control control{};
+        finalize(control);
+        return control;
+    }
+
+    void reset() { state_.reset(); }
+
+    static Control compute(std::string_view data) {
+        Detector detector;
+        detector.update(data);
+        return detector.finalize();
+    }
+
+    static bool verify(std::string_view data, const Control& expected) {
+        return compute(data) == expected;
+    }
+
+    // Display form, identical to ErrorDetection::generateControlInfo
+    static std::string toText(const Control& control) { return Policy::toText(control); }
+
+    // Binary frame form
+    static void appendBytes(std::string& out, const Control& control) { Policy::appendBytes(out, control); }
+    static bool fromBytes(std::string_view bytes, Control& control) { return Policy::fromBytes(bytes, control); }
+
+private:
+    typename Policy::State state_;
+};
+
+// Resolve a runtime method once and call f with the matching policy object,
+// so that everything f does with it is specialized at compile time:
+//   withDetectorPolicy(method, [&](auto policy) {
+//       using D = Detector<decltype(policy)>;
+//       ...
+//   });
+template <typename F>
+decltype(auto) withDetectorPolicy(ErrorDetectionMethod method, F&& f) {
+    switch (method) {
+        case ErrorDetectionMethod::PARITY_2D: return f(Parity2DPolicy{});
+        case ErrorDetectionMethod::CRC16: return f(Crc16Policy{});
+        case ErrorDetectionMethod::HAMMING: return f(HammingPolicy{});
+        case ErrorDetectionMethod::CHECKSUM: return f(ChecksumPolicy{});
+        case ErrorDetectionMethod::CRC16_CCITT: return f(Crc16CcittPolicy{});
+        case ErrorDetectionMethod::CRC32: return f(Crc32Policy{});
+        case ErrorDetectionMethod::CRC32C: return f(Crc32cPolicy{});
+        case ErrorDetectionMethod::CRC64: return f(Crc64Policy{});
+        case ErrorDetectionMethod::HAMMING_SECDED: return f(SecdedPolicy{});
+        default: return f(ParityPolicy{});
+    }
+}
+
+#endif // DETECTOR_H
@@ -9,14 +9,383 @@
 #include <iomanip>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <array>
+#include <iostream>
+#include "crc_engine.h"
+#include "internet_checksum.h"
+#include "parity_matrix.h"
+#include "cpu_dispatch.h"
 
-// Error detection method types
-enum class ErrorDetectionMethod {
-    PARITY,
-    PARITY_2D,
-    CRC16,
-    HAMMING,
-    CHECKSUM
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define ERROR_DETECTION_X86 1
+#endif
+
+// Error detection method types (values are the method ids used on the wire)
+enum class ErrorDetectionMethod : uint8_t {
+    PARITY = 0,
+    PARITY_2D = 1,
+    CRC16 = 2,
+    HAMMING = 3,
+    CHECKSUM = 4,
+    CRC16_CCITT = 5,
+    CRC32 = 6,
+    CRC32C = 7,
+    CRC64 = 8,
+    HAMMING_SECDED = 9
+};
+
+// Outcome of decoding SECDED-protected data
+enum class HammingStatus {
+    CLEAN,          // No errors found
+    CORRECTED,      // Only single-bit errors, all corrected in place
+    UNCORRECTABLE   // At least one block had a double-bit error
+};
+
+struct HammingDecodeResult {
+    HammingStatus status = HammingStatus::CLEAN;
+    size_t correctedBits = 0;
+    size_t uncorrectableBlocks = 0;
+};
+
+// Streaming detector contexts. Feed the payload through any number of
+// update() calls and read the raw control value with finalize(); chunked
+// results equal the one-shot ErrorDetection functions, which wrap these.
+
+// Running XOR of the payload, 64 bits at a time. Only the parity of the
+// accumulator matters, so the vector kernels may fold their lanes in any
+// order.
+class ParityStream {
+public:
+    using XorFn = uint64_t (*)(const uint8_t*, size_t);
+
+    static uint64_t xorScalar(const uint8_t* data, size_t length) {
+        uint64_t acc = 0;
+        while (length >= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            acc ^= word;
+            data += 8;
+            length -= 8;
+        }
+        while (length--) {
+            acc ^= *data++;
+        }
+        return acc;
+    }
+
+#ifdef ERROR_DETECTION_X86
+    __attribute__((target("sse2")))
+    static uint64_t xorSse2(const uint8_t* data, size_t length) {
+        __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+        while (length >= 32) {
+            acc0 = _mm_xor_si128(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+            acc1 = _mm_xor_si128(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+            data += 32;
+            length -= 32;
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_xor_si128(acc0, acc1));
+        return lanes[0] ^ lanes[1] ^ xorScalar(data, length);
+    }
+
+    __attribute__((target("avx2")))
+    static uint64_t xorAvx2(const uint8_t* data, size_t length) {
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+        while (length >= 64) {
+            acc0 = _mm256_xor_si256(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)));
+            acc1 = _mm256_xor_si256(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32)));
+            data += 64;
+            length -= 64;
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_xor_si256(acc0, acc1));
+        return lanes[0] ^ lanes[1] ^ lanes[2] ^ lanes[3] ^ xorScalar(data, length);
+    }
+
+    __attribute__((target("avx512f")))
+    static uint64_t xorAvx512(const uint8_t* data, size_t length) {
+        __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+        while (length >= 128) {
+            acc0 = _mm512_xor_si512(acc0, _mm512_loadu_si512(data));
+            acc1 = _mm512_xor_si512(acc1, _mm512_loadu_si512(data + 64));
+            data += 128;
+            length -= 128;
+        }
+        uint64_t lanes[8];
+        _mm512_storeu_si512(lanes, _mm512_xor_si512(acc0, acc1));
+        uint64_t acc = xorScalar(data, length);
+        for (uint64_t lane : lanes) acc ^= lane;
+        return acc;
+    }
+#endif
+
+    // XOR kernel for an instruction set level
+    static XorFn xorKernel(CpuLevel level) {
+#ifdef ERROR_DETECTION_X86
+        if (level >= CpuLevel::AVX512) return &xorAvx512;
+        if (level >= CpuLevel::AVX2) return &xorAvx2;
+        if (level >= CpuLevel::SSE42) return &xorSse2;
+#endif
+        (void)level;
+        return &xorScalar;
+    }
+
+    static XorFn xorKernel() {
+        static const XorFn fn = xorKernel(CpuDispatch::level());
+        return fn;
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        acc_ ^= xorKernel()(data, length);
+    }
+
+    // True if the payload holds an odd number of 1 bits
+    bool finalize() const { return __builtin_parityll(acc_); }
+
+    void reset() { acc_ = 0; }
+
+private:
+    uint64_t acc_ = 0;
+};
+
+template <typename Engine>
+class CrcStream {
+public:
+    using Value = typename Engine::Value;
+
+    void update(const uint8_t* data, size_t length) { crc_ = Engine::update(crc_, data, length); }
+    Value finalize() const { return Engine::finalize(crc_); }
+    void reset() { crc_ = Engine::initial(); }
+
+private:
+    Value crc_ = Engine::initial();
+};
+
+// Total number of 1s across the Hamming(7,4) codewords of the payload
+class HammingStream {
+public:
+    // Number of 1s in the two codewords built from a byte (high nibble
+    // first): data bits plus the p1, p2 and p4 parity bits
+    static constexpr std::array<uint8_t, 256> makeWeights() {
+        std::array<uint8_t, 256> weights{};
+        for (int b = 0; b < 256; b++) {
+            int ones = 0;
+            for (int nibble : {b >> 4, b & 0xF}) {
+                int d0 = (nibble >> 3) & 1, d1 = (nibble >> 2) & 1;
+                int d2 = (nibble >> 1) & 1, d3 = nibble & 1;
+                ones += d0 + d1 + d2 + d3;
+                ones += d0 ^ d1 ^ d3;
+                ones += d0 ^ d2 ^ d3;
+                ones += d1 ^ d2 ^ d3;
+            }
+            weights[b] = static_cast<uint8_t>(ones);
+        }
+        return weights;
+    }
+
+    using WeighFn = uint64_t (*)(const uint8_t*, size_t);
+
+    // The weight of a byte is the sum of the weights of its nibbles, which
+    // the vector kernels look up with a byte shuffle. The 16-entry table is
+    // repeated for each 128-bit lane of the widest register.
+    static constexpr std::array<uint8_t, 64> makeNibbleWeights() {
+        std::array<uint8_t, 64> weights{};
+        for (int i = 0; i < 64; i++) {
+            weights[i] = makeWeights()[i % 16];
+        }
+        return weights;
+    }
+
+    static uint64_t weighScalar(const uint8_t* data, size_t length) {
+        static constexpr std::array<uint8_t, 256> WEIGHTS = makeWeights();
+        uint64_t ones = 0;
+        for (size_t i = 0; i < length; i++) {
+            ones += WEIGHTS[data[i]];
+        }
+        return ones;
+    }
+
+#ifdef ERROR_DETECTION_X86
+    __attribute__((target("ssse3")))
+    static uint64_t weighSsse3(const uint8_t* data, size_t length) {
+        static constexpr std::array<uint8_t, 64> NIBBLES = makeNibbleWeights();
+        const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(NIBBLES.data()));
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = zero;
+        while (length >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(v, mask));
+            __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_add_epi8(low, high), zero));
+            data += 16;
+            length -= 16;
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        return lanes[0] + lanes[1] + weighScalar(data, length);
+    }
+
+    __attribute__((target("avx2")))
+    static uint64_t weighAvx2(const uint8_t* data, size_t length) {
+        static constexpr std::array<uint8_t, 64> NIBBLES = makeNibbleWeights();
+        const __m256i table = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(NIBBLES.data()));
+        const __m256i mask = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc = zero;
+        while (length >= 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, mask));
+            __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(low, high), zero));
+            data += 32;
+            length -= 32;
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + weighScalar(data, length);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static uint64_t weighAvx512(const uint8_t* data, size_t length) {
+        static constexpr std::array<uint8_t, 64> NIBBLES = makeNibbleWeights();
+        const __m512i table = _mm512_loadu_si512(NIBBLES.data());
+        const __m512i mask = _mm512_set1_epi8(0x0F);
+        const __m512i zero = _mm512_setzero_si512();
+        __m512i acc = zero;
+        while (length >= 64) {
+            __m512i v = _mm512_loadu_si512(data);
+            __m512i low = _mm512_shuffle_epi8(table, _mm512_and_si512(v, mask));
+            __m512i high = _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), mask));
+            acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_add_epi8(low, high), zero));
+            data += 64;
+            length -= 64;
+        }
+        uint64_t lanes[8];
+        _mm512_storeu_si512(lanes, acc);
+        uint64_t ones = weighScalar(data, length);
+        for (uint64_t lane : lanes) ones += lane;
+        return ones;
+    }
+#endif
+
+    // Weighing kernel for an instruction set level
+    static WeighFn weighKernel(CpuLevel level) {
+#ifdef ERROR_DETECTION_X86
+        if (level >= CpuLevel::AVX512) return &weighAvx512;
+        if (level >= CpuLevel::AVX2) return &weighAvx2;
+        if (level >= CpuLevel::SSE42) return &weighSsse3;
+#endif
+        (void)level;
+        return &weighScalar;
+    }
+
+    static WeighFn weighKernel() {
+        static const WeighFn fn = weighKernel(CpuDispatch::level());
+        return fn;
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        ones_ += weighKernel()(data, length);
+    }
+
+    uint64_t finalize() const { return ones_; }
+    void reset() { ones_ = 0; }
+
+private:
+    uint64_t ones_ = 0;
+};
+
+// Internet checksum; chunks starting at an odd offset have the halves of
+// their partial sum swapped before they are added in
+class ChecksumStream {
+public:
+    void update(const uint8_t* data, size_t length) {
+        uint16_t partial = InternetChecksum::fold(InternetChecksum::sumKernel()(data, length));
+        if (offset_ & 1) partial = InternetChecksum::swapBytes(partial);
+        sum_ += partial;
+        offset_ += length;
+    }
+
+    uint16_t finalize() const {
+        return static_cast<uint16_t>(~InternetChecksum::swapBytes(InternetChecksum::fold(sum_)));
+    }
+
+    void reset() {
+        sum_ = 0;
+        offset_ = 0;
+    }
+
+private:
+    uint64_t sum_ = 0;
+    size_t offset_ = 0;
+};
+
+// Extended Hamming (SECDED) check bits of every byte, as hex digit pairs.
+// Every data byte is one Hamming(12,8) codeword: positions 1, 2, 4 and 8
+// hold parity bits, positions 3, 5-7 and 9-12 hold data bits d7..d0 (MSB
+// first). An overall parity bit over all twelve makes it Hamming(13,8).
+class SecdedStream {
+public:
+    static constexpr int DATA_POSITIONS[8] = {3, 5, 6, 7, 9, 10, 11, 12};
+
+    // Check bits per data byte: bits 0-3 are p1, p2, p4, p8, bit 4 is overall
+    static constexpr std::array<uint8_t, 256> makeCheckBits() {
+        std::array<uint8_t, 256> table{};
+        for (int b = 0; b < 256; b++) {
+            int hamming = 0;
+            int ones = 0;
+            for (int i = 0; i < 8; i++) {
+                if ((b >> (7 - i)) & 1) {
+                    hamming ^= DATA_POSITIONS[i];
+                    ones++;
+                }
+            }
+            for (int k = 0; k < 4; k++) ones += (hamming >> k) & 1;
+            table[b] = static_cast<uint8_t>(hamming | ((ones & 1) << 4));
+        }
+        return table;
+    }
+
+    // Data-byte mask to flip for each 4-bit position syndrome (0 if the
+    // syndrome points at a parity bit or outside the codeword)
+    static constexpr std::array<uint8_t, 16> makeCorrections() {
+        std::array<uint8_t, 16> table{};
+        for (int i = 0; i < 8; i++) {
+            table[DATA_POSITIONS[i]] = static_cast<uint8_t>(0x80 >> i);
+        }
+        return table;
+    }
+
+    static const std::array<uint8_t, 256>& checkBits() {
+        static constexpr std::array<uint8_t, 256> TABLE = makeCheckBits();
+        return TABLE;
+    }
+
+    static const std::array<uint8_t, 16>& corrections() {
+        static constexpr std::array<uint8_t, 16> TABLE = makeCorrections();
+        return TABLE;
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        static const char HEX[] = "0123456789ABCDEF";
+        const std::array<uint8_t, 256>& table = checkBits();
+        size_t start = control_.size();
+        control_.resize(start + length * 2);
+        for (size_t i = 0; i < length; i++) {
+            uint8_t check = table[data[i]];
+            control_[start + 2 * i] = HEX[check >> 4];
+            control_[start + 2 * i + 1] = HEX[check & 0xF];
+        }
+    }
+
+    const std::string& finalize() const { return control_; }
+    void reset() { control_.clear(); }
+
+private:
+    std::string control_;
 };
 
 // Utility functions
@@ -31,6 +400,25 @@ public:
         return binary;
     }
 
+    // Format an integer control value as fixed-width uppercase hex
+    static std::string toHex(uint64_t value, int digits) {
+        std::string result;
+        appendHex(result, value, digits);
+        return result;
+    }
+
+    // Like toHex, values wider than `digits` are not truncated
+    static void appendHex(std::string& out, uint64_t value, int digits) {
+        static const char HEX[] = "0123456789ABCDEF";
+        while (digits < 16 && (value >> (4 * digits)) != 0) digits++;
+        size_t start = out.size();
+        out.resize(start + digits);
+        for (int i = digits - 1; i >= 0; i--) {
+            out[start + i] = HEX[value & 0xF];
+            value >>= 4;
+        }
+    }
+
     // Count number of 1s in binary string
     static int countOnes(const std::string& binary) {
         return std::count(binary.begin(), binary.end(), '1');
@@ -38,159 +426,178 @@ public:
 
     // 1. Parity Bit (Even/Odd)
     static std::string calculateParity(const std::string& data, bool evenParity = true) {
-        std::string binary = stringToBinary(data);
-        int ones = countOnes(binary);
-        bool parityBit = evenParity ? (ones % 2 != 0) : (ones % 2 == 0);
+        ParityStream stream;
+        stream.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        bool odd = stream.finalize();
+        bool parityBit = evenParity ? odd : !odd;
         return parityBit ? "1" : "0";
     }
 
-    // 2. 2D Parity (Matrix Parity)
-    static std::string calculate2DParity(const std::string& data, int rows = 8) {
-        if (data.empty()) return "0|0";
-        
-        // Convert to binary first
-        std::string binary = stringToBinary(data);
-        
-        int cols = (binary.length() + rows - 1) / rows; // Ceiling division
-        std::vector<std::vector<bool>> matrix(rows, std::vector<bool>(cols, false));
-        
-        // Fill matrix with data bits
-        for (size_t i = 0; i < binary.length(); i++) {
-            int row = i % rows;
-            int col = i / rows;
-            if (col < cols) {
-                matrix[row][col] = (binary[i] == '1');
-            }
-        }
-        
-        // Calculate row parities
-        std::string rowParity;
-        for (int i = 0; i < rows; i++) {
-            int ones = 0;
-            for (int j = 0; j < cols; j++) {
-                if (matrix[i][j]) ones++;
-            }
-            rowParity += (ones % 2 == 0) ? "0" : "1";
-        }
-        
-        // Calculate column parities
-        std::string colParity;
-        for (int j = 0; j < cols; j++) {
-            int ones = 0;
-            for (int i = 0; i < rows; i++) {
-                if (matrix[i][j]) ones++;
+    // Pack a bit vector into 4-bit groups, left-padded with zeros. Each
+    // group is emitted as its raw value (0-15), not as an ASCII hex digit,
+    // which is what the original stream-based formatting produced.
+    static std::string packNibbles(const PackedBits& bits) {
+        std::string result;
+        appendNibbles(result, bits);
+        return result;
+    }
+
+    static void appendNibbles(std::string& out, const PackedBits& bits) {
+        size_t pad = (4 - bits.size % 4) % 4;
+        size_t count = (bits.size + pad) / 4;
+        size_t start = out.size();
+        out.resize(start + count);
+        for (size_t k = 0; k < count; k++) {
+            long long pos = static_cast<long long>(4 * k) - static_cast<long long>(pad);
+            uint64_t nibble;
+            if (pos >= 0 && pos % 64 <= 60) {
+                nibble = (bits.words[pos / 64] >> (60 - pos % 64)) & 0xF;
+            } else {
+                nibble = bits.read(pos, 4);
             }
-            colParity += (ones % 2 == 0) ? "0" : "1";
+            out[start + k] = static_cast<char>(nibble);
         }
+    }
+
+    // 2. 2D Parity (Matrix Parity)
+    // Bit i of the MSB-first bit stream lands in row i % rows, column i / rows.
+    static std::string calculate2DParity(const std::string& data, int rows = 8) {
+        if (data.empty() || rows < 1) return "0|0";
         
-        // Convert binary strings to hex for compact representation
-        auto binaryToHex = [](const std::string& binary) -> std::string {
-            std::stringstream ss;
-            ss << std::hex << std::uppercase << std::setfill('0');
-            
-            // Pad to multiple of 4 bits for hex conversion
-            std::string padded = binary;
-            while (padded.length() % 4 != 0) {
-                padded = "0" + padded;
-            }
-            
-            // Convert each 4-bit group to hex
-            for (size_t i = 0; i < padded.length(); i += 4) {
-                std::string nibble = padded.substr(i, 4);
-                uint8_t val = static_cast<uint8_t>(std::bitset<4>(nibble).to_ulong());
-                ss << std::setw(1) << val;
-            }
-            
-            return ss.str();
-        };
-        
-        std::string rowHex = binaryToHex(rowParity);
-        std::string colHex = binaryToHex(colParity);
+        PackedBits rowParity, colParity;
+        ParityMatrix::compute(reinterpret_cast<const uint8_t*>(data.data()), data.size(),
+                              static_cast<size_t>(rows), rowParity, colParity);
         
-        return rowHex + "|" + colHex;
+        return packNibbles(rowParity) + "|" + packNibbles(colParity);
     }
 
     // 3. CRC-16 (using polynomial 0x8005)
+    static uint16_t computeCRC16(const uint8_t* data, size_t length) {
+        CrcStream<Crc16Engine> stream;
+        stream.update(data, length);
+        return stream.finalize();
+    }
+
+    static uint16_t computeCRC16(const std::string& data) {
+        return computeCRC16(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
     static std::string calculateCRC16(const std::string& data) {
-        uint16_t crc = 0xFFFF;
-        uint16_t polynomial = 0x8005;
-        
-        for (char c : data) {
-            crc ^= (static_cast<uint16_t>(c) << 8);
-            for (int i = 0; i < 8; i++) {
-                if (crc & 0x8000) {
-                    crc = (crc << 1) ^ polynomial;
-                } else {
-                    crc <<= 1;
-                }
-            }
-        }
-        
-        std::stringstream ss;
-        ss << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << crc;
-        return ss.str();
+        return toHex(computeCRC16(data), 4);
     }
 
     // 4. Hamming Code (for 4-bit blocks)
+    // Returns a checksum of the Hamming(7,4) codewords (total number of 1s)
     static std::string calculateHamming(const std::string& data) {
-        std::string binary = stringToBinary(data);
-        std::string hammingResult;
-        
-        // Process in 4-bit blocks
-        for (size_t i = 0; i < binary.length(); i += 4) {
-            std::string block = binary.substr(i, 4);
-            if (block.length() < 4) {
-                block += std::string(4 - block.length(), '0');
-            }
-            
-            // Calculate parity bits for Hamming(7,4)
-            // Positions: 1, 2, 4 are parity bits
-            bool p1 = (block[0] - '0') ^ (block[1] - '0') ^ (block[3] - '0');
-            bool p2 = (block[0] - '0') ^ (block[2] - '0') ^ (block[3] - '0');
-            bool p4 = (block[1] - '0') ^ (block[2] - '0') ^ (block[3] - '0');
-            
-            hammingResult += std::to_string(p1) + std::to_string(p2) + block[0] + 
-                           std::to_string(p4) + block.substr(1);
-        }
-        
-        // Return a checksum of the hamming codes
-        int checksum = 0;
-        for (char c : hammingResult) {
-            checksum += (c - '0');
-        }
-        
-        std::stringstream ss;
-        ss << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << checksum;
-        return ss.str();
+        HammingStream stream;
+        stream.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        return toHex(stream.finalize(), 4);
     }
 
     // 5. Internet Checksum (16-bit)
+    static uint16_t computeChecksum(const uint8_t* data, size_t length) {
+        ChecksumStream stream;
+        stream.update(data, length);
+        return stream.finalize();
+    }
+
+    static uint16_t computeChecksum(const std::string& data) {
+        return computeChecksum(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
     static std::string calculateChecksum(const std::string& data) {
-        uint32_t sum = 0;
-        
-        // Process in 16-bit chunks
-        for (size_t i = 0; i < data.length(); i += 2) {
-            uint16_t word = 0;
-            if (i < data.length()) {
-                word = static_cast<uint8_t>(data[i]) << 8;
+        return toHex(computeChecksum(data), 4);
+    }
+
+    // 6. Parameterized CRC family (see crc_engine.h for the parameters)
+    template <typename Engine>
+    static typename Engine::Value computeCRC(const std::string& data) {
+        CrcStream<Engine> stream;
+        stream.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        return stream.finalize();
+    }
+
+    static std::string calculateCRC16CCITT(const std::string& data) {
+        return toHex(computeCRC<Crc16CcittEngine>(data), 4);
+    }
+
+    static std::string calculateCRC32(const std::string& data) {
+        return toHex(computeCRC<Crc32Engine>(data), 8);
+    }
+
+    static std::string calculateCRC32C(const std::string& data) {
+        return toHex(computeCRC<Crc32cEngine>(data), 8);
+    }
+
+    static std::string calculateCRC64(const std::string& data) {
+        return toHex(computeCRC<Crc64Engine>(data), 16);
+    }
+
+    // 7. Extended Hamming (SECDED) over each byte
+    // The control information carries the five check bits of every codeword
+    // as two hex digits per byte; the data bits travel as the payload itself.
+    static std::string calculateSECDED(const std::string& data) {
+        SecdedStream stream;
+        stream.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        return stream.finalize();
+    }
+
+    // Verify data against SECDED control information, correcting single-bit
+    // errors in place and flagging blocks with double-bit errors
+    static HammingDecodeResult decodeSECDED(std::string& data, const std::string& control) {
+        const std::array<uint8_t, 256>& checkBits = SecdedStream::checkBits();
+        const std::array<uint8_t, 16>& corrections = SecdedStream::corrections();
+
+        HammingDecodeResult result;
+        if (control.size() != data.size() * 2) {
+            result.status = HammingStatus::UNCORRECTABLE;
+            result.uncorrectableBlocks = data.size();
+            return result;
+        }
+
+        auto hexValue = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        };
+
+        for (size_t i = 0; i < data.size(); i++) {
+            int hi = hexValue(control[2 * i]);
+            int lo = hexValue(control[2 * i + 1]);
+            if (hi < 0 || lo < 0 || hi > 1) {
+                result.uncorrectableBlocks++;
+                continue;
             }
-            if (i + 1 < data.length()) {
-                word |= static_cast<uint8_t>(data[i + 1]);
+            uint8_t received = static_cast<uint8_t>((hi << 4) | lo);
+            uint8_t byte = static_cast<uint8_t>(data[i]);
+
+            // Position syndrome, and overall parity of the received codeword
+            int syndrome = (checkBits[byte] ^ received) & 0xF;
+            bool overall = __builtin_parity(byte) ^ __builtin_parity(received);
+
+            if (!overall) {
+                // Either clean or an even number of errors
+                if (syndrome != 0) result.uncorrectableBlocks++;
+            } else if (syndrome == 0 || (syndrome & (syndrome - 1)) == 0) {
+                // Single error in the overall or a Hamming parity bit
+                result.correctedBits++;
+            } else if (corrections[syndrome] != 0) {
+                // Single error in a data bit
+                data[i] = static_cast<char>(byte ^ corrections[syndrome]);
+                result.correctedBits++;
+            } else {
+                // Syndrome points outside the codeword: multiple errors
+                result.uncorrectableBlocks++;
             }
-            sum += word;
         }
-        
-        // Add carry bits
-        while (sum >> 16) {
-            sum = (sum & 0xFFFF) + (sum >> 16);
+
+        if (result.uncorrectableBlocks > 0) {
+            result.status = HammingStatus::UNCORRECTABLE;
+        } else if (result.correctedBits > 0) {
+            result.status = HammingStatus::CORRECTED;
         }
-        
-        // One's complement
-        uint16_t checksum = ~static_cast<uint16_t>(sum);
-        
-        std::stringstream ss;
-        ss << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << checksum;
-        return ss.str();
+        return result;
     }
 
     // Generate control information based on method
@@ -206,6 +613,16 @@ public:
                 return calculateHamming(data);
             case ErrorDetectionMethod::CHECKSUM:
                 return calculateChecksum(data);
+            case ErrorDetectionMethod::CRC16_CCITT:
+                return calculateCRC16CCITT(data);
+            case ErrorDetectionMethod::CRC32:
+                return calculateCRC32(data);
+            case ErrorDetectionMethod::CRC32C:
+                return calculateCRC32C(data);
+            case ErrorDetectionMethod::CRC64:
+                return calculateCRC64(data);
+            case ErrorDetectionMethod::HAMMING_SECDED:
+                return calculateSECDED(data);
             default:
                 return "";
         }
@@ -219,6 +636,11 @@ public:
             case ErrorDetectionMethod::CRC16: return "CRC16";
             case ErrorDetectionMethod::HAMMING: return "HAMMING";
             case ErrorDetectionMethod::CHECKSUM: return "CHECKSUM";
+            case ErrorDetectionMethod::CRC16_CCITT: return "CRC16CCITT";
+            case ErrorDetectionMethod::CRC32: return "CRC32";
+            case ErrorDetectionMethod::CRC32C: return "CRC32C";
+            case ErrorDetectionMethod::CRC64: return "CRC64";
+            case ErrorDetectionMethod::HAMMING_SECDED: return "SECDED";
             default: return "UNKNOWN";
         }
     }
@@ -230,9 +652,250 @@ public:
         if (methodStr == "CRC16") return ErrorDetectionMethod::CRC16;
         if (methodStr == "HAMMING") return ErrorDetectionMethod::HAMMING;
         if (methodStr == "CHECKSUM") return ErrorDetectionMethod::CHECKSUM;
+        if (methodStr == "CRC16CCITT") return ErrorDetectionMethod::CRC16_CCITT;
+        if (methodStr == "CRC32") return ErrorDetectionMethod::CRC32;
+        if (methodStr == "CRC32C") return ErrorDetectionMethod::CRC32C;
+        if (methodStr == "CRC64") return ErrorDetectionMethod::CRC64;
+        if (methodStr == "SECDED") return ErrorDetectionMethod::HAMMING_SECDED;
         return ErrorDetectionMethod::PARITY;
     }
 };
 
+// Streaming detector for a method chosen at runtime. finalize() returns the
+// same control string as ErrorDetection::generateControlInfo and resets the
+// stream for the next payload.
+class DetectionStream {
+public:
+    explicit DetectionStream(ErrorDetectionMethod method, int rows = 8)
+        : method_(method), matrix_(rows < 1 ? 1 : static_cast<size_t>(rows)) {}
+
+    ErrorDetectionMethod method() const { return method_; }
+
+    void update(const uint8_t* data, size_t length) {
+        length_ += length;
+        switch (method_) {
+            case ErrorDetectionMethod::PARITY: parity_.update(data, length); break;
+            case ErrorDetectionMethod::PARITY_2D: matrix_.update(data, length); break;
+            case ErrorDetectionMethod::CRC16: crc16_.update(data, length); break;
+            case ErrorDetectionMethod::HAMMING: hamming_.update(data, length); break;
+            case ErrorDetectionMethod::CHECKSUM: checksum_.update(data, length); break;
+            case ErrorDetectionMethod::CRC16_CCITT: crc16Ccitt_.update(data, length); break;
+            case ErrorDetectionMethod::CRC32: crc32_.update(data, length); break;
+            case ErrorDetectionMethod::CRC32C: crc32c_.update(data, length); break;
+            case ErrorDetectionMethod::CRC64: crc64_.update(data, length); break;
+            case ErrorDetectionMethod::HAMMING_SECDED: secded_.update(data, length); break;
+        }
+    }
+
+    void update(const std::string& data) {
+        update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    std::string finalize() {
+        std::string control;
+        finalize(control);
+        return control;
+    }
+
+    // Same, writing into a caller-owned string so that a loop reusing it
+    // allocates nothing once the buffers have grown
+    void finalize(std::string& control) {
+        control.clear();
+        switch (method_) {
+            case ErrorDetectionMethod::PARITY:
+                control.push_back(parity_.finalize() ? '1' : '0');
+                break;
+            case ErrorDetectionMethod::PARITY_2D:
+                if (length_ == 0) {
+                    control.assign("0|0");
+                } else {
+                    matrix_.finish(rowParity_, colParity_);
+                    ErrorDetection::appendNibbles(control, rowParity_);
+                    control.push_back('|');
+                    ErrorDetection::appendNibbles(control, colParity_);
+                }
+                break;
+            case ErrorDetectionMethod::CRC16:
+                ErrorDetection::appendHex(control, crc16_.finalize(), 4);
+                break;
+            case ErrorDetectionMethod::HAMMING:
+                ErrorDetection::appendHex(control, hamming_.finalize(), 4);
+                break;
+            case ErrorDetectionMethod::CHECKSUM:
+                ErrorDetection::appendHex(control, checksum_.finalize(), 4);
+                break;
+            case ErrorDetectionMethod::CRC16_CCITT:
+                ErrorDetection::appendHex(control, crc16Ccitt_.finalize(), 4);
+                break;
+            case ErrorDetectionMethod::CRC32:
+                ErrorDetection::appendHex(control, crc32_.finalize(), 8);
+                break;
+            case ErrorDetectionMethod::CRC32C:
+                ErrorDetection::appendHex(control, crc32c_.finalize(), 8);
+                break;
+            case ErrorDetectionMethod::CRC64:
+                ErrorDetection::appendHex(control, crc64_.finalize(), 16);
+                break;
+            case ErrorDetectionMethod::HAMMING_SECDED:
+                control.assign(secded_.finalize());
+                break;
+        }
+        reset();
+    }
+
+    void reset() {
+        length_ = 0;
+        parity_.reset();
+        matrix_.reset();
+        crc16_.reset();
+        hamming_.reset();
+        checksum_.reset();
+        crc16Ccitt_.reset();
+        crc32_.reset();
+        crc32c_.reset();
+        crc64_.reset();
+        secded_.reset();
+    }
+
+private:
+    ErrorDetectionMethod method_;
+    size_t length_ = 0;
+    ParityStream parity_;
+    ParityMatrix matrix_;
+    PackedBits rowParity_;
+    PackedBits colParity_;
+    CrcStream<Crc16Engine> crc16_;
+    HammingStream hamming_;
+    ChecksumStream checksum_;
+    CrcStream<Crc16CcittEngine> crc16Ccitt_;
+    CrcStream<Crc32Engine> crc32_;
+    CrcStream<Crc32cEngine> crc32c_;
+    CrcStream<Crc64Engine> crc64_;
+    SecdedStream secded_;
+};
+
+// Startup self-check of the CPU-specific kernels. Every kernel the selected
+// level may use is run on buffers of many lengths and alignments and
+// compared with the portable implementation, so a broken code path is caught
+// before any packet depends on it. The 2D parity layouts, one-shot and
+// streamed, are checked against a bit-at-a-time reference the same way.
+class KernelSelfCheck {
+public:
+    // Run the check and explain a failure on stderr; for program startup
+    static bool verify() {
+        std::string failure;
+        if (run(failure)) return true;
+        std::cerr << "Kernel self-check failed: " << failure << "\n"
+                  << "Set " << CpuDispatch::ENVIRONMENT_VARIABLE << " to a lower level to avoid this code path."
+                  << std::endl;
+        return false;
+    }
+
+    // True if all kernels agree; otherwise failure names the first mismatch
+    static bool run(std::string& failure) {
+        std::vector<uint8_t> buffer(LARGE + 64);
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (uint8_t& byte : buffer) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            byte = static_cast<uint8_t>(state >> 56);
+        }
+
+        for (int l = 0; l <= static_cast<int>(CpuDispatch::level()); l++) {
+            CpuLevel level = static_cast<CpuLevel>(l);
+            if (!checkCrc<Crc16Engine>("CRC16", level, buffer, failure) ||
+                !checkCrc<Crc16CcittEngine>("CRC16CCITT", level, buffer, failure) ||
+                !checkCrc<Crc32Engine>("CRC32", level, buffer, failure) ||
+                !checkCrc<Crc32cEngine>("CRC32C", level, buffer, failure) ||
+                !checkCrc<Crc64Engine>("CRC64", level, buffer, failure)) {
+                return false;
+            }
+
+            InternetChecksum::SumFn sum = InternetChecksum::sumKernel(level);
+            ParityStream::XorFn parity = ParityStream::xorKernel(level);
+            HammingStream::WeighFn weigh = HammingStream::weighKernel(level);
+            bool ok = forEachSlice([&](const uint8_t* data, size_t length) {
+                if (InternetChecksum::fold(sum(data, length)) !=
+                    InternetChecksum::fold(InternetChecksum::sumScalar(data, length))) {
+                    return report(failure, "CHECKSUM", level, data - buffer.data(), length);
+                }
+                if (__builtin_parityll(parity(data, length)) !=
+                    __builtin_parityll(ParityStream::xorScalar(data, length))) {
+                    return report(failure, "PARITY", level, data - buffer.data(), length);
+                }
+                if (weigh(data, length) != HammingStream::weighScalar(data, length)) {
+                    return report(failure, "HAMMING", level, data - buffer.data(), length);
+                }
+                return true;
+            }, buffer);
+            if (!ok) return false;
+        }
+        return checkParityMatrix(buffer, failure);
+    }
+
+private:
+    static constexpr size_t SMALL = 300;       // Every length up to this
+    static constexpr size_t LARGE = 4096 + 7;
+
+    // Row counts that exercise the default byte columns, the generic path
+    // with a partial last column, and columns of more than one word. The
+    // reference is slow, so only short payloads are checked.
+    static bool checkParityMatrix(const std::vector<uint8_t>& buffer, std::string& failure) {
+        const size_t maxLength = 100;
+        PackedBits row, col, expectedRow, expectedCol;
+        for (size_t rows : {3, 7, 8, 9, 63, 64, 65, 100, 129}) {
+            ParityMatrix matrix(rows);
+            for (size_t length = 0; length <= maxLength; length++) {
+                ParityMatrix::computeScalar(buffer.data(), length, rows, expectedRow, expectedCol);
+                ParityMatrix::compute(buffer.data(), length, rows, row, col);
+                bool same = row.words == expectedRow.words && col.words == expectedCol.words;
+                // Streamed in two uneven pieces, as DetectionStream may be
+                matrix.update(buffer.data(), length / 3);
+                matrix.update(buffer.data() + length / 3, length - length / 3);
+                matrix.finish(row, col);
+                if (!same || row.words != expectedRow.words || col.words != expectedCol.words) {
+                    failure = "2D parity with " + std::to_string(rows) +
+                              " rows disagrees with the bit-at-a-time layout (length " + std::to_string(length) + ")";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <typename Check>
+    static bool forEachSlice(Check check, const std::vector<uint8_t>& buffer) {
+        for (size_t offset = 0; offset < 8; offset++) {
+            for (size_t length = 0; length <= SMALL; length++) {
+                if (!check(buffer.data() + offset, length)) return false;
+            }
+            if (!check(buffer.data() + offset, LARGE)) return false;
+        }
+        return true;
+    }
+
+    template <typename Engine>
+    static bool checkCrc(const char* name, CpuLevel level, const std::vector<uint8_t>& buffer,
+                         std::string& failure) {
+        typename Engine::UpdateFn fn = Engine::acceleratedUpdate(level);
+        if (!fn) return true;
+        return forEachSlice([&](const uint8_t* data, size_t length) {
+            // Start from a nonzero register too, as chunked updates do
+            for (typename Engine::Value crc : {Engine::initial(), static_cast<typename Engine::Value>(0x1234)}) {
+                if (fn(crc, data, length) != Engine::updateTable(crc, data, length)) {
+                    return report(failure, name, level, data - buffer.data(), length);
+                }
+            }
+            return true;
+        }, buffer);
+    }
+
+    static bool report(std::string& failure, const char* kernel, CpuLevel level, size_t offset, size_t length) {
+        failure = std::string(kernel) + " kernel for level " + CpuDispatch::levelToString(level) +
+                  " disagrees with the portable implementation (offset " + std::to_string(offset) +
+                  ", length " + std::to_string(length) + ")";
+        return false;
+    }
+};
+
 #endif // ERROR_DETECTION_H
 
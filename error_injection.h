@@ -4,8 +4,16 @@
 #include <string>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
 #include <bitset>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
 
 // Error injection method types
 enum class ErrorInjectionMethod {
@@ -15,17 +23,114 @@ enum class ErrorInjectionMethod {
     CHAR_INSERTION,
     CHAR_SWAPPING,
     MULTIPLE_BIT_FLIPS,
-    BURST_ERROR
+    BURST_ERROR,
+    NONE            // Nothing to corrupt (empty payload)
+};
+
+// One edit made by an injector, in the order applied. Offsets are byte
+// offsets into the buffer as it was when the edit was made, so replaying the
+// edits in order on the original payload reproduces the corruption exactly.
+enum class EditOp : uint8_t {
+    XOR,        // data[offset] ^= value (bit flips)
+    SET,        // data[offset] = value
+    INSERT,     // insert value before data[offset]
+    DELETE,     // remove data[offset]
+    SWAP,       // swap data[offset] and data[offset + 1]
+    FILL        // set length bytes from offset to value (erasures)
+};
+
+struct CorruptionEdit {
+    EditOp op;
+    uint8_t value;
+    uint32_t offset;
+    uint32_t length;
+};
+
+using CorruptionEdits = std::vector<CorruptionEdit>;
+
+// xoshiro256** (Blackman and Vigna): 32 bytes of state and a few cycles per
+// 64-bit output. Satisfies UniformRandomBitGenerator, so the standard
+// distributions work with it unchanged.
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t value = 0) { seed(value); }
+
+    // Expand the seed with splitmix64 so that similar seeds give unrelated streams
+    void seed(uint64_t value) {
+        for (uint64_t& word : state_) {
+            value += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = value;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+private:
+    uint64_t state_[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
 };
 
 class ErrorInjection {
 private:
-    static std::mt19937& getRandomGenerator() {
-        static std::mt19937 gen(static_cast<unsigned>(std::time(nullptr)));
+    // One generator per thread, so injecting from several threads needs no
+    // locking. Each thread starts from its own seed.
+    static Xoshiro256& getRandomGenerator() {
+        static std::atomic<uint64_t> streams{0};
+        thread_local Xoshiro256 gen(
+            (static_cast<uint64_t>(std::time(nullptr)) << 20) ^ std::random_device{}() ^
+            (streams.fetch_add(1, std::memory_order_relaxed) * 0xD1B54A32D192ED03ULL));
         return gen;
     }
 
 public:
+    // Reseed the calling thread's generator
+    static void seed(uint64_t value) {
+        getRandomGenerator().seed(value);
+    }
+
+    // Fresh seed for an independent generator, drawn from the calling thread's
+    static uint64_t randomSeed() {
+        return getRandomGenerator()();
+    }
+
+    // Seed of stream number `stream` under a master seed: one splitmix64
+    // round over both, so neighbouring streams get unrelated generators
+    static uint64_t deriveSeed(uint64_t seed, uint64_t stream) {
+        uint64_t z = seed ^ (stream * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Every injector works in place on data[0..length) and updates length.
+    // Insertion needs one spare byte, so capacity must be at least
+    // length + MAX_GROWTH; otherwise it leaves the data untouched and returns
+    // false. Positions, counts and characters are drawn exactly as the
+    // std::string versions always have, from gen (by default the calling
+    // thread's generator). With edits, every change is also appended there.
+    static constexpr size_t MAX_GROWTH = 1;
+
     // Convert string to binary and back
     static std::string binaryToString(const std::string& binary) {
         std::string result;
@@ -47,148 +152,624 @@ public:
         return binary;
     }
 
+    // Flip bit pos of the payload, counting from the most significant bit of
+    // the first byte (the order of the stringToBinary() representation)
+    static void flipBit(char* data, size_t pos, CorruptionEdits* edits = nullptr) {
+        uint8_t mask = static_cast<uint8_t>(0x80 >> (pos & 7));
+        data[pos >> 3] ^= static_cast<char>(mask);
+        record(edits, EditOp::XOR, pos >> 3, mask);
+    }
+
+    static void record(CorruptionEdits* edits, EditOp op, size_t offset, uint8_t value = 0, size_t length = 1) {
+        if (edits) {
+            edits->push_back({op, value, static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+        }
+    }
+
+    // Replay recorded edits on data[0..length); edits that do not fit the
+    // buffer are skipped. Returns the number applied.
+    static size_t applyEdits(char* data, size_t& length, size_t capacity,
+                             const CorruptionEdit* edits, size_t count) {
+        size_t applied = 0;
+        for (size_t i = 0; i < count; i++) {
+            const CorruptionEdit& edit = edits[i];
+            size_t offset = edit.offset;
+            switch (edit.op) {
+                case EditOp::XOR:
+                    if (offset >= length) continue;
+                    data[offset] ^= static_cast<char>(edit.value);
+                    break;
+                case EditOp::SET:
+                    if (offset >= length) continue;
+                    data[offset] = static_cast<char>(edit.value);
+                    break;
+                case EditOp::INSERT:
+                    if (offset > length || length + 1 > capacity) continue;
+                    std::memmove(data + offset + 1, data + offset, length - offset);
+                    data[offset] = static_cast<char>(edit.value);
+                    length++;
+                    break;
+                case EditOp::DELETE:
+                    if (offset >= length) continue;
+                    std::memmove(data + offset, data + offset + 1, length - offset - 1);
+                    length--;
+                    break;
+                case EditOp::SWAP:
+                    if (offset + 1 >= length) continue;
+                    std::swap(data[offset], data[offset + 1]);
+                    break;
+                case EditOp::FILL:
+                    if (offset >= length) continue;
+                    std::memset(data + offset, edit.value, std::min<size_t>(edit.length, length - offset));
+                    break;
+                default:
+                    continue;
+            }
+            applied++;
+        }
+        return applied;
+    }
+
     // 1. Bit Flip
-    static std::string injectBitFlip(const std::string& data) {
-        if (data.empty()) return data;
-        
-        std::string binary = stringToBinary(data);
-        std::mt19937& gen = getRandomGenerator();
-        std::uniform_int_distribution<> dis(0, binary.length() - 1);
-        
-        int pos = dis(gen);
-        binary[pos] = (binary[pos] == '0') ? '1' : '0';
-        
-        return binaryToString(binary);
+    static bool injectBitFlip(char* data, size_t& length, size_t /*capacity*/,
+                              Xoshiro256& gen = getRandomGenerator(),
+                              CorruptionEdits* edits = nullptr) {
+        if (length == 0) return true;
+
+        std::uniform_int_distribution<> dis(0, length * 8 - 1);
+
+        flipBit(data, dis(gen), edits);
+        return true;
     }
 
     // 2. Character Substitution
-    static std::string injectCharSubstitution(const std::string& data) {
-        if (data.empty()) return data;
-        
-        std::mt19937& gen = getRandomGenerator();
-        std::uniform_int_distribution<> posDis(0, data.length() - 1);
+    static bool injectCharSubstitution(char* data, size_t& length, size_t /*capacity*/,
+                                       Xoshiro256& gen = getRandomGenerator(),
+                                       CorruptionEdits* edits = nullptr) {
+        if (length == 0) return true;
+
+        std::uniform_int_distribution<> posDis(0, length - 1);
         std::uniform_int_distribution<> charDis(32, 126); // Printable ASCII
-        
-        std::string corrupted = data;
+
         int pos = posDis(gen);
-        corrupted[pos] = static_cast<char>(charDis(gen));
-        
-        return corrupted;
+        data[pos] = static_cast<char>(charDis(gen));
+        record(edits, EditOp::SET, pos, static_cast<uint8_t>(data[pos]));
+        return true;
     }
 
     // 3. Character Deletion
-    static std::string injectCharDeletion(const std::string& data) {
-        if (data.empty()) return data;
-        
-        std::mt19937& gen = getRandomGenerator();
-        std::uniform_int_distribution<> dis(0, data.length() - 1);
-        
-        std::string corrupted = data;
-        corrupted.erase(dis(gen), 1);
-        
-        return corrupted;
+    static bool injectCharDeletion(char* data, size_t& length, size_t /*capacity*/,
+                                   Xoshiro256& gen = getRandomGenerator(),
+                                   CorruptionEdits* edits = nullptr) {
+        if (length == 0) return true;
+
+        std::uniform_int_distribution<> dis(0, length - 1);
+
+        size_t pos = dis(gen);
+        std::memmove(data + pos, data + pos + 1, length - pos - 1);
+        length--;
+        record(edits, EditOp::DELETE, pos);
+        return true;
     }
 
     // 4. Random Character Insertion
-    static std::string injectCharInsertion(const std::string& data) {
-        if (data.empty()) {
-            std::mt19937& gen = getRandomGenerator();
-            std::uniform_int_distribution<> charDis(32, 126);
-            return std::string(1, static_cast<char>(charDis(gen)));
-        }
-        
-        std::mt19937& gen = getRandomGenerator();
-        std::uniform_int_distribution<> posDis(0, data.length());
+    static bool injectCharInsertion(char* data, size_t& length, size_t capacity,
+                                    Xoshiro256& gen = getRandomGenerator(),
+                                    CorruptionEdits* edits = nullptr) {
+        if (capacity < length + MAX_GROWTH) return false;
+
         std::uniform_int_distribution<> charDis(32, 126);
-        
-        std::string corrupted = data;
-        int pos = posDis(gen);
-        corrupted.insert(pos, 1, static_cast<char>(charDis(gen)));
-        
-        return corrupted;
+        if (length == 0) {
+            data[0] = static_cast<char>(charDis(gen));
+            length = 1;
+            record(edits, EditOp::INSERT, 0, static_cast<uint8_t>(data[0]));
+            return true;
+        }
+
+        std::uniform_int_distribution<> posDis(0, length);
+
+        size_t pos = posDis(gen);
+        std::memmove(data + pos + 1, data + pos, length - pos);
+        data[pos] = static_cast<char>(charDis(gen));
+        length++;
+        record(edits, EditOp::INSERT, pos, static_cast<uint8_t>(data[pos]));
+        return true;
     }
 
     // 5. Character Swapping
-    static std::string injectCharSwapping(const std::string& data) {
-        if (data.length() < 2) return data;
-        
-        std::mt19937& gen = getRandomGenerator();
-        std::uniform_int_distribution<> dis(0, data.length() - 2);
-        
-        std::string corrupted = data;
+    static bool injectCharSwapping(char* data, size_t& length, size_t /*capacity*/,
+                                   Xoshiro256& gen = getRandomGenerator(),
+                                   CorruptionEdits* edits = nullptr) {
+        if (length < 2) return true;
+
+        std::uniform_int_distribution<> dis(0, length - 2);
+
         int pos = dis(gen);
-        std::swap(corrupted[pos], corrupted[pos + 1]);
-        
-        return corrupted;
+        std::swap(data[pos], data[pos + 1]);
+        record(edits, EditOp::SWAP, pos);
+        return true;
     }
 
     // 6. Multiple Bit Flips
-    static std::string injectMultipleBitFlips(const std::string& data) {
-        if (data.empty()) return data;
-        
-        std::string binary = stringToBinary(data);
-        std::mt19937& gen = getRandomGenerator();
+    static bool injectMultipleBitFlips(char* data, size_t& length, size_t /*capacity*/,
+                                       Xoshiro256& gen = getRandomGenerator(),
+                                       CorruptionEdits* edits = nullptr) {
+        if (length == 0) return true;
+
         std::uniform_int_distribution<> countDis(2, 5); // 2-5 bit flips
-        std::uniform_int_distribution<> posDis(0, binary.length() - 1);
-        
+        std::uniform_int_distribution<> posDis(0, length * 8 - 1);
+
         int flips = countDis(gen);
         for (int i = 0; i < flips; i++) {
-            int pos = posDis(gen);
-            binary[pos] = (binary[pos] == '0') ? '1' : '0';
+            flipBit(data, posDis(gen), edits);
         }
-        
-        return binaryToString(binary);
+        return true;
     }
 
-    // 7. Burst Error (3-8 consecutive characters corrupted)
-    static std::string injectBurstError(const std::string& data) {
-        if (data.empty()) return data;
-        
-        std::mt19937& gen = getRandomGenerator();
-        std::uniform_int_distribution<> burstDis(3, std::min(8, static_cast<int>(data.length())));
-        std::uniform_int_distribution<> posDis(0, std::max(0, static_cast<int>(data.length()) - 3));
+    // 7. Burst Error (3-8 consecutive characters corrupted; the whole
+    // payload when it is shorter than 3)
+    static bool injectBurstError(char* data, size_t& length, size_t /*capacity*/,
+                                 Xoshiro256& gen = getRandomGenerator(),
+                                 CorruptionEdits* edits = nullptr) {
+        if (length == 0) return true;
+
+        int size = static_cast<int>(std::min(length, static_cast<size_t>(8)));
+        std::uniform_int_distribution<> burstDis(std::min(3, size), size);
+        std::uniform_int_distribution<> posDis(0, std::max(0, static_cast<int>(length) - 3));
         std::uniform_int_distribution<> charDis(32, 126);
-        
+
         int burstSize = burstDis(gen);
-        int startPos = posDis(gen);
-        
-        std::string corrupted = data;
-        for (int i = 0; i < burstSize && (startPos + i) < static_cast<int>(corrupted.length()); i++) {
-            corrupted[startPos + i] = static_cast<char>(charDis(gen));
+        size_t startPos = posDis(gen);
+
+        for (int i = 0; i < burstSize && startPos + i < length; i++) {
+            data[startPos + i] = static_cast<char>(charDis(gen));
+            record(edits, EditOp::SET, startPos + i, static_cast<uint8_t>(data[startPos + i]));
         }
-        
-        return corrupted;
+        return true;
     }
 
-    // Inject error using random method
-    static std::string injectError(const std::string& data) {
-        if (data.empty()) return data;
-        
-        std::mt19937& gen = getRandomGenerator();
+    // Inject error using random method; returns the method applied
+    static ErrorInjectionMethod injectError(char* data, size_t& length, size_t capacity,
+                                            Xoshiro256& gen = getRandomGenerator(),
+                                            CorruptionEdits* edits = nullptr) {
+        if (length == 0) return ErrorInjectionMethod::NONE;
+
         std::uniform_int_distribution<> methodDis(0, 6);
-        
+
         ErrorInjectionMethod method = static_cast<ErrorInjectionMethod>(methodDis(gen));
-        
+        inject(method, data, length, capacity, gen, edits);
+        return method;
+    }
+
+    // Inject error using the given method
+    static void inject(ErrorInjectionMethod method, char* data, size_t& length, size_t capacity,
+                       Xoshiro256& gen = getRandomGenerator(),
+                       CorruptionEdits* edits = nullptr) {
         switch (method) {
             case ErrorInjectionMethod::BIT_FLIP:
-                return injectBitFlip(data);
+                injectBitFlip(data, length, capacity, gen, edits);
+                break;
             case ErrorInjectionMethod::CHAR_SUBSTITUTION:
-                return injectCharSubstitution(data);
+                injectCharSubstitution(data, length, capacity, gen, edits);
+                break;
             case ErrorInjectionMethod::CHAR_DELETION:
-                return injectCharDeletion(data);
+                injectCharDeletion(data, length, capacity, gen, edits);
+                break;
             case ErrorInjectionMethod::CHAR_INSERTION:
-                return injectCharInsertion(data);
+                injectCharInsertion(data, length, capacity, gen, edits);
+                break;
             case ErrorInjectionMethod::CHAR_SWAPPING:
-                return injectCharSwapping(data);
+                injectCharSwapping(data, length, capacity, gen, edits);
+                break;
             case ErrorInjectionMethod::MULTIPLE_BIT_FLIPS:
-                return injectMultipleBitFlips(data);
+                injectMultipleBitFlips(data, length, capacity, gen, edits);
+                break;
             case ErrorInjectionMethod::BURST_ERROR:
-                return injectBurstError(data);
-            default:
-                return injectCharSubstitution(data);
+                injectBurstError(data, length, capacity, gen, edits);
+                break;
+            case ErrorInjectionMethod::NONE:
+                break;
+        }
+    }
+
+    // Get method name as string
+    static std::string methodToString(ErrorInjectionMethod method) {
+        switch (method) {
+            case ErrorInjectionMethod::BIT_FLIP: return "BIT_FLIP";
+            case ErrorInjectionMethod::CHAR_SUBSTITUTION: return "CHAR_SUBSTITUTION";
+            case ErrorInjectionMethod::CHAR_DELETION: return "CHAR_DELETION";
+            case ErrorInjectionMethod::CHAR_INSERTION: return "CHAR_INSERTION";
+            case ErrorInjectionMethod::CHAR_SWAPPING: return "CHAR_SWAPPING";
+            case ErrorInjectionMethod::MULTIPLE_BIT_FLIPS: return "MULTIPLE_BIT_FLIPS";
+            case ErrorInjectionMethod::BURST_ERROR: return "BURST_ERROR";
+            default: return "NONE";
+        }
+    }
+
+    // Run an in-place injector on a std::string, resizing it to the result
+    template<typename Injector>
+    static auto applyTo(std::string& data, Injector injector) {
+        size_t length = data.size();
+        data.resize(length + MAX_GROWTH);
+        auto result = injector(&data[0], length, data.size());
+        data.resize(length);
+        return result;
+    }
+
+    // Corrupt data in place; returns the method applied
+    static ErrorInjectionMethod corrupt(std::string& data) {
+        return applyTo(data, [](char* p, size_t& n, size_t c) { return injectError(p, n, c); });
+    }
+
+    // std::string versions: return a corrupted copy
+    static std::string injectBitFlip(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectBitFlip(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectCharSubstitution(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectCharSubstitution(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectCharDeletion(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectCharDeletion(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectCharInsertion(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectCharInsertion(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectCharSwapping(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectCharSwapping(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectMultipleBitFlips(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectMultipleBitFlips(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectBurstError(const std::string& data) {
+        std::string corrupted = data;
+        applyTo(corrupted, [](char* p, size_t& n, size_t c) { return injectBurstError(p, n, c); });
+        return corrupted;
+    }
+
+    static std::string injectError(const std::string& data) {
+        std::string corrupted = data;
+        corrupt(corrupted);
+        return corrupted;
+    }
+};
+
+// Channel models: statistical corruption of a byte stream, as an
+// alternative to injectError()'s one hand-written corruption per packet.
+// A model keeps its own generator and carries its state (the distance to
+// the next error, the Gilbert-Elliott state) from one packet to the next,
+// so a run of packets behaves like one continuous line. Gaps between errors
+// are drawn from geometric distributions, so the cost of apply() grows with
+// the number of errors injected, not with the number of bits.
+class ChannelModel {
+public:
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    explicit ChannelModel(uint64_t seed) : gen_(seed) {}
+    virtual ~ChannelModel() = default;
+
+    // Corrupt data[0..length) in place and update length; returns the number
+    // of errors injected. capacity must allow ErrorInjection::MAX_GROWTH.
+    // With edits, every change is also appended there.
+    virtual size_t apply(char* data, size_t& length, size_t capacity, CorruptionEdits* edits = nullptr) = 0;
+
+    // Model specification in the form accepted by create()
+    virtual std::string describe() const = 0;
+
+    // If the next length bytes are sure to pass untouched, advance the model
+    // past them exactly as apply() would and return true, so the caller may
+    // forward them without reading them; otherwise change nothing
+    virtual bool passesClean(size_t /*length*/) { return false; }
+
+    size_t apply(std::string& data, CorruptionEdits* edits = nullptr) {
+        return ErrorInjection::applyTo(data, [this, edits](char* p, size_t& n, size_t c) {
+            return apply(p, n, c, edits);
+        });
+    }
+
+    // Restart the stream: reseed the generator and forget carried-over state
+    void seed(uint64_t value) {
+        gen_.seed(value);
+        bits_ = 0;
+        errors_ = 0;
+        restart();
+    }
+
+    uint64_t bitsProcessed() const { return bits_; }
+    uint64_t errorsInjected() const { return errors_; }
+
+    // Build a model from a specification:
+    //   random                          one injectError() corruption per packet
+    //   ber:P                           independent bit errors with probability P
+    //   ge:P_GB,P_BG[,BER_G[,BER_B]]    Gilbert-Elliott: per-bit transition
+    //                                   probabilities good->bad and bad->good,
+    //                                   and the bit error rate in each state
+    //                                   (defaults 0 and 0.5)
+    //   erasure:P[,SPAN]                each byte starts an erasure of SPAN
+    //                                   bytes (default 1) with probability P
+    // Returns nullptr if the specification is invalid.
+    static std::unique_ptr<ChannelModel> create(const std::string& spec,
+                                                uint64_t seed = ErrorInjection::randomSeed());
+
+protected:
+    Xoshiro256 gen_;
+    uint64_t bits_ = 0;
+    uint64_t errors_ = 0;
+
+    virtual void restart() {}
+
+    static std::string formatNumber(double value) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%g", value);
+        return text;
+    }
+
+    // Uniform on (0, 1]
+    double uniform() {
+        return static_cast<double>((gen_() >> 11) + 1) * 0x1.0p-53;
+    }
+
+    // Number of failures before the first success of independent trials with
+    // success probability p, by inversion: floor(ln U / ln(1 - p))
+    uint64_t geometric(double p) {
+        if (p <= 0.0) return NEVER;
+        if (p >= 1.0) return 0;
+        double skip = std::floor(std::log(uniform()) / std::log1p(-p));
+        return skip >= 1.8e19 ? NEVER : static_cast<uint64_t>(skip);
+    }
+
+    // Flip the bit errors of a span of bits that starts at bit pos, given
+    // the number of clean bits before the next error; returns the errors
+    // injected and leaves gap pointing past the span
+    size_t flipSpan(char* data, uint64_t pos, uint64_t span, uint64_t& gap, double ber,
+                    CorruptionEdits* edits) {
+        size_t count = 0;
+        while (gap < span) {
+            pos += gap;
+            span -= gap + 1;
+            ErrorInjection::flipBit(data, pos++, edits);
+            count++;
+            gap = geometric(ber);
         }
+        gap -= span;
+        return count;
     }
 };
 
-#endif // ERROR_INJECTION_H
+// The original behavior: one injectError() corruption per non-empty packet
+class RandomMethodChannel : public ChannelModel {
+public:
+    explicit RandomMethodChannel(uint64_t seed) : ChannelModel(seed) {}
+
+    size_t apply(char* data, size_t& length, size_t capacity, CorruptionEdits* edits = nullptr) override {
+        bits_ += static_cast<uint64_t>(length) * 8;
+        if (ErrorInjection::injectError(data, length, capacity, gen_, edits) == ErrorInjectionMethod::NONE) return 0;
+        errors_++;
+        return 1;
+    }
+
+    std::string describe() const override { return "random"; }
+};
+
+// Binary symmetric channel: every bit flips independently with probability ber
+class BitErrorChannel : public ChannelModel {
+public:
+    BitErrorChannel(double ber, uint64_t seed) : ChannelModel(seed), ber_(ber) {
+        restart();
+    }
+
+    size_t apply(char* data, size_t& length, size_t /*capacity*/, CorruptionEdits* edits = nullptr) override {
+        uint64_t bits = static_cast<uint64_t>(length) * 8;
+        size_t count = flipSpan(data, 0, bits, gap_, ber_, edits);
+        bits_ += bits;
+        errors_ += count;
+        return count;
+    }
 
+    std::string describe() const override { return "ber:" + formatNumber(ber_); }
+
+    bool passesClean(size_t length) override {
+        uint64_t bits = static_cast<uint64_t>(length) * 8;
+        if (gap_ < bits) return false;
+        gap_ -= bits;
+        bits_ += bits;
+        return true;
+    }
+
+private:
+    double ber_;
+    uint64_t gap_ = 0;
+
+    void restart() override { gap_ = geometric(ber_); }
+};
+
+// Two-state Markov channel for burst errors. The state can change after every
+// bit (good->bad with probability pGoodToBad, bad->good with pBadToGood), so
+// bursts last 1/pBadToGood bits on average; inside a state bits flip
+// independently at that state's error rate.
+class GilbertElliottChannel : public ChannelModel {
+public:
+    GilbertElliottChannel(double pGoodToBad, double pBadToGood, double berGood, double berBad, uint64_t seed)
+        : ChannelModel(seed), pGoodToBad_(pGoodToBad), pBadToGood_(pBadToGood),
+          berGood_(berGood), berBad_(berBad) {
+        restart();
+    }
+
+    size_t apply(char* data, size_t& length, size_t /*capacity*/, CorruptionEdits* edits = nullptr) override {
+        uint64_t bits = static_cast<uint64_t>(length) * 8;
+        uint64_t pos = 0;
+        size_t count = 0;
+        while (pos < bits) {
+            uint64_t span = std::min(stateLeft_, bits - pos);
+            count += flipSpan(data, pos, span, gap_, bad_ ? berBad_ : berGood_, edits);
+            pos += span;
+            stateLeft_ -= span;
+            if (stateLeft_ == 0) switchState();
+        }
+        bits_ += bits;
+        errors_ += count;
+        return count;
+    }
+
+    std::string describe() const override {
+        return "ge:" + formatNumber(pGoodToBad_) + "," + formatNumber(pBadToGood_) +
+               "," + formatNumber(berGood_) + "," + formatNumber(berBad_);
+    }
+
+    // Only within the current state: the next one's gaps are not drawn yet
+    bool passesClean(size_t length) override {
+        uint64_t bits = static_cast<uint64_t>(length) * 8;
+        if (gap_ < bits || stateLeft_ < bits) return false;
+        gap_ -= bits;
+        stateLeft_ -= bits;
+        if (stateLeft_ == 0) switchState();
+        bits_ += bits;
+        return true;
+    }
+
+private:
+    double pGoodToBad_;
+    double pBadToGood_;
+    double berGood_;
+    double berBad_;
+    bool bad_ = false;
+    uint64_t stateLeft_ = 0;
+    uint64_t gap_ = 0;
+
+    // Bits spent in the current state, at least one
+    uint64_t duration() {
+        uint64_t stay = geometric(bad_ ? pBadToGood_ : pGoodToBad_);
+        return stay == NEVER ? NEVER : stay + 1;
+    }
+
+    // Gaps are memoryless, so the new state's gap can be drawn afresh
+    void switchState() {
+        bad_ = !bad_;
+        stateLeft_ = duration();
+        gap_ = geometric(bad_ ? berBad_ : berGood_);
+    }
+
+    void restart() override {
+        bad_ = false;
+        stateLeft_ = duration();
+        gap_ = geometric(berGood_);
+    }
+};
+
+// Lost symbols: each byte starts an erasure with probability rate, and the
+// span bytes from there on are overwritten with fill. Positions are kept, so
+// the receiver sees damaged bytes rather than a shorter packet.
+class ErasureChannel : public ChannelModel {
+public:
+    ErasureChannel(double rate, size_t span, uint64_t seed, char fill = 0)
+        : ChannelModel(seed), rate_(rate), span_(span == 0 ? 1 : span), fill_(fill) {
+        restart();
+    }
+
+    size_t apply(char* data, size_t& length, size_t /*capacity*/, CorruptionEdits* edits = nullptr) override {
+        size_t pos = 0;
+        size_t count = 0;
+
+        // An erasure that began in the previous packet
+        size_t carried = std::min(pending_, length);
+        std::memset(data, fill_, carried);
+        if (carried > 0) ErrorInjection::record(edits, EditOp::FILL, 0, static_cast<uint8_t>(fill_), carried);
+        pending_ -= carried;
+        pos = carried;
+
+        while (pos < length && gap_ < length - pos) {
+            pos += gap_;
+            size_t erased = std::min(span_, length - pos);
+            std::memset(data + pos, fill_, erased);
+            ErrorInjection::record(edits, EditOp::FILL, pos, static_cast<uint8_t>(fill_), erased);
+            pending_ = span_ - erased;
+            pos += erased;
+            count++;
+            gap_ = geometric(rate_);
+        }
+        if (pos < length) gap_ -= length - pos;
+
+        bits_ += static_cast<uint64_t>(length) * 8;
+        errors_ += count;
+        return count;
+    }
+
+    std::string describe() const override {
+        return "erasure:" + formatNumber(rate_) + "," + std::to_string(span_);
+    }
+
+    bool passesClean(size_t length) override {
+        if (pending_ > 0 || gap_ < length) return false;
+        gap_ -= length;
+        bits_ += static_cast<uint64_t>(length) * 8;
+        return true;
+    }
+
+private:
+    double rate_;
+    size_t span_;
+    char fill_;
+    uint64_t gap_ = 0;
+    size_t pending_ = 0;
+
+    void restart() override {
+        gap_ = geometric(rate_);
+        pending_ = 0;
+    }
+};
+
+inline std::unique_ptr<ChannelModel> ChannelModel::create(const std::string& spec, uint64_t seed) {
+    std::string name = spec.substr(0, spec.find(':'));
+    std::vector<double> params;
+    if (name.size() < spec.size()) {
+        const char* p = spec.c_str() + name.size() + 1;
+        for (;;) {
+            char* end;
+            double value = std::strtod(p, &end);
+            if (end == p || value < 0.0) return nullptr;
+            params.push_back(value);
+            if (*end == '\0') break;
+            if (*end != ',') return nullptr;
+            p = end + 1;
+        }
+    }
+
+    auto probability = [&](size_t i) { return params[i] <= 1.0; };
+
+    if (name == "random" && params.empty()) {
+        return std::make_unique<RandomMethodChannel>(seed);
+    }
+    if (name == "ber" && params.size() == 1 && probability(0)) {
+        return std::make_unique<BitErrorChannel>(params[0], seed);
+    }
+    if (name == "ge" && params.size() >= 2 && params.size() <= 4) {
+        if (params.size() < 3) params.push_back(0.0);
+        if (params.size() < 4) params.push_back(0.5);
+        if (!probability(0) || !probability(1) || !probability(2) || !probability(3)) return nullptr;
+        return std::make_unique<GilbertElliottChannel>(params[0], params[1], params[2], params[3], seed);
+    }
+    if (name == "erasure" && (params.size() == 1 || params.size() == 2) && probability(0)) {
+        size_t span = params.size() == 2 ? static_cast<size_t>(params[1]) : 1;
+        return std::make_unique<ErasureChannel>(params[0], span, seed);
+    }
+    return nullptr;
+}
+
+#endif // ERROR_INJECTION_H
@@ -0,0 +1,337 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <tuple>
+#include "error_detection.h"
+#include "detector.h"
+#include "error_injection.h"
+
+// Monte Carlo estimate of how often each error detection method misses a
+// corruption: every trial draws a payload, computes its control information,
+// corrupts a copy and checks whether the control information of the copy
+// still matches, the way Client 2 would.
+
+#define DEFAULT_TRIALS 100000
+#define DEFAULT_SIZES "16,64,256,1024"
+#define CONFIDENCE_Z 1.959963984540054  // 95% two-sided
+
+// An error model: one of the injection methods, or a channel model spec
+struct ErrorModel {
+    std::string name;
+    ErrorInjectionMethod method;
+    std::string channel;    // Empty for injection methods
+};
+
+// Outcome counts of one detection method / error model / payload size cell
+struct Tally {
+    uint64_t trials = 0;
+    uint64_t corrupted = 0;     // Trials whose payload actually changed
+    uint64_t undetected = 0;    // Corrupted, yet the control information matched
+};
+
+// A detector with the control values of the original payload and of the
+// corrupted copy, of the type its policy defines
+template <typename Policy>
+struct DetectorSlot {
+    Detector<Policy> detector;
+    typename Policy::Control reference{};
+    typename Policy::Control control{};
+};
+
+template <typename Policies>
+struct DetectorSlots;
+
+template <typename... Policies>
+struct DetectorSlots<std::tuple<Policies...>> {
+    using type = std::tuple<DetectorSlot<Policies>...>;
+};
+
+struct Settings {
+    uint64_t trials = DEFAULT_TRIALS;
+    std::vector<size_t> sizes;
+    std::vector<ErrorDetectionMethod> detections;  // In DetectorPolicies order
+    std::vector<ErrorModel> models;
+    unsigned threads = 1;
+    uint64_t seed = 0;
+    bool text = false;
+    bool json = false;
+
+    size_t cell(size_t size, size_t model, size_t detection) const {
+        return (size * models.size() + model) * detections.size() + detection;
+    }
+};
+
+// Runs its share of the trials of every cell. All buffers are sized for the
+// largest payload up front, so the trial loop never allocates. Every method
+// has its own slot, so the loop over methods unrolls at compile time and
+// integer control values are compared as integers.
+class TrialRunner {
+public:
+    TrialRunner(const Settings& settings, unsigned index)
+        : settings_(settings), gen_(ErrorInjection::deriveSeed(settings.seed, index)),
+          tallies_(settings.sizes.size() * settings.models.size() * settings.detections.size()) {
+        // Trials split evenly, the first threads take the remainder
+        trials_ = settings.trials / settings.threads + (index < settings.trials % settings.threads ? 1 : 0);
+
+        size_t maxSize = 0;
+        for (size_t size : settings.sizes) maxSize = std::max(maxSize, size);
+        original_.resize(maxSize);
+        corrupted_.resize(maxSize + ErrorInjection::MAX_GROWTH);
+
+        std::apply([&](auto&... slot) {
+            (reserveControl(slot.reference, 2 * maxSize + 16), ...);
+            (reserveControl(slot.control, 2 * maxSize + 16), ...);
+        }, slots_);
+
+        for (const ErrorModel& model : settings.models) {
+            channels_.push_back(model.channel.empty() ? nullptr
+                : ChannelModel::create(model.channel, gen_()));
+        }
+    }
+
+    const std::vector<Tally>& tallies() const { return tallies_; }
+
+    void run() {
+        for (size_t s = 0; s < settings_.sizes.size(); s++) {
+            size_t size = settings_.sizes[s];
+            for (uint64_t trial = 0; trial < trials_; trial++) {
+                fillPayload(size);
+                std::apply([&](auto&... slot) {
+                    ((slot.detector.update(reinterpret_cast<const uint8_t*>(original_.data()), size),
+                      slot.detector.finalize(slot.reference)), ...);
+                }, slots_);
+                for (size_t m = 0; m < channels_.size(); m++) {
+                    runTrial(s, m, size);
+                }
+            }
+        }
+    }
+
+private:
+    const Settings& settings_;
+    Xoshiro256 gen_;
+    uint64_t trials_;
+    std::vector<Tally> tallies_;
+    std::string original_;
+    std::string corrupted_;
+    DetectorSlots<DetectorPolicies>::type slots_;
+    std::vector<std::unique_ptr<ChannelModel>> channels_;
+
+    void fillPayload(size_t size) {
+        for (size_t i = 0; i < size; i += 8) {
+            uint64_t word = gen_();
+            size_t count = std::min<size_t>(8, size - i);
+            if (settings_.text) {
+                // Printable ASCII, like the data Client 1 sends
+                for (size_t k = 0; k < count; k++) {
+                    original_[i + k] = static_cast<char>(32 + ((word >> (8 * k)) & 0xFF) % 95);
+                }
+            } else {
+                std::memcpy(&original_[i], &word, count);
+            }
+        }
+    }
+
+    void runTrial(size_t s, size_t m, size_t size) {
+        char* data = &corrupted_[0];
+        size_t length = size;
+        std::memcpy(data, original_.data(), size);
+        if (channels_[m]) {
+            channels_[m]->apply(data, length, corrupted_.size());
+        } else {
+            ErrorInjection::inject(settings_.models[m].method, data, length, corrupted_.size(), gen_);
+        }
+        bool changed = length != size || std::memcmp(data, original_.data(), size) != 0;
+
+        size_t d = 0;
+        std::apply([&](auto&... slot) {
+            (checkTrial(slot, tallies_[settings_.cell(s, m, d++)], data, length, changed), ...);
+        }, slots_);
+    }
+
+    template <typename Slot>
+    static void checkTrial(Slot& slot, Tally& tally, const char* data, size_t length, bool changed) {
+        tally.trials++;
+        if (!changed) return;
+        tally.corrupted++;
+        slot.detector.update(reinterpret_cast<const uint8_t*>(data), length);
+        slot.detector.finalize(slot.control);
+        if (slot.control == slot.reference) tally.undetected++;
+    }
+
+    // Variable-length control values get their capacity up front
+    template <typename Control>
+    static void reserveControl(Control&, size_t) {}
+
+    static void reserveControl(std::string& control, size_t capacity) { control.reserve(capacity); }
+};
+
+// Wilson score interval for a binomial proportion; stays meaningful when no
+// misses were observed at all
+void wilsonInterval(uint64_t successes, uint64_t n, double& low, double& high) {
+    if (n == 0) {
+        low = 0.0;
+        high = 1.0;
+        return;
+    }
+    double z2 = CONFIDENCE_Z * CONFIDENCE_Z;
+    double p = static_cast<double>(successes) / n;
+    double denominator = 1.0 + z2 / n;
+    double center = (p + z2 / (2.0 * n)) / denominator;
+    double half = CONFIDENCE_Z * std::sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / denominator;
+    low = successes == 0 ? 0.0 : std::max(0.0, center - half);
+    high = successes == n ? 1.0 : std::min(1.0, center + half);
+}
+
+void printResults(const Settings& settings, const std::vector<Tally>& totals) {
+    if (settings.json) std::cout << "[\n";
+    else std::cout << "detection,error_model,payload_bytes,trials,corrupted,undetected,"
+                      "undetected_rate,ci95_low,ci95_high\n";
+
+    bool first = true;
+    char line[512];
+    for (size_t s = 0; s < settings.sizes.size(); s++) {
+        for (size_t m = 0; m < settings.models.size(); m++) {
+            for (size_t d = 0; d < settings.detections.size(); d++) {
+                const Tally& tally = totals[settings.cell(s, m, d)];
+                double rate = tally.corrupted ? static_cast<double>(tally.undetected) / tally.corrupted : 0.0;
+                double low, high;
+                wilsonInterval(tally.undetected, tally.corrupted, low, high);
+                std::string detection = ErrorDetection::methodToString(settings.detections[d]);
+                const std::string& model = settings.models[m].name;
+
+                if (settings.json) {
+                    std::snprintf(line, sizeof(line),
+                                  "%s  {\"detection\": \"%s\", \"error_model\": \"%s\", \"payload_bytes\": %zu, "
+                                  "\"trials\": %llu, \"corrupted\": %llu, \"undetected\": %llu, "
+                                  "\"undetected_rate\": %.6e, \"ci95_low\": %.6e, \"ci95_high\": %.6e}",
+                                  first ? "" : ",\n", detection.c_str(), model.c_str(), settings.sizes[s],
+                                  static_cast<unsigned long long>(tally.trials),
+                                  static_cast<unsigned long long>(tally.corrupted),
+                                  static_cast<unsigned long long>(tally.undetected), rate, low, high);
+                } else {
+                    // Channel specs may contain commas
+                    const char* quote = model.find(',') != std::string::npos ? "\"" : "";
+                    std::snprintf(line, sizeof(line), "%s,%s%s%s,%zu,%llu,%llu,%llu,%.6e,%.6e,%.6e\n",
+                                  detection.c_str(), quote, model.c_str(), quote, settings.sizes[s],
+                                  static_cast<unsigned long long>(tally.trials),
+                                  static_cast<unsigned long long>(tally.corrupted),
+                                  static_cast<unsigned long long>(tally.undetected), rate, low, high);
+                }
+                std::cout << line;
+                first = false;
+            }
+        }
+    }
+    if (settings.json) std::cout << "\n]\n";
+}
+
+bool parseSizes(const std::string& list, std::vector<size_t>& sizes) {
+    sizes.clear();
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        char* rest;
+        unsigned long long size = std::strtoull(item.c_str(), &rest, 10);
+        if (item.empty() || *rest != '\0' || size == 0) return false;
+        sizes.push_back(static_cast<size_t>(size));
+        start = end + 1;
+    }
+    return !sizes.empty();
+}
+
+int main(int argc, char* argv[]) {
+    // --trials N per detection method, error model and payload size.
+    // --sizes LIST of payload sizes in bytes.
+    // --channel SPEC adds a channel model (see ChannelModel::create) to the
+    // injection methods; may be repeated.
+    // --text draws printable payloads instead of arbitrary bytes.
+    // --json prints JSON instead of CSV.
+    Settings settings;
+    settings.threads = std::max(1u, std::thread::hardware_concurrency());
+    settings.seed = ErrorInjection::randomSeed();
+    std::string sizes = DEFAULT_SIZES;
+    std::vector<std::string> channels;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--trials") == 0 && i + 1 < argc && std::atoll(argv[i + 1]) > 0) {
+            settings.trials = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizes = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            settings.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            settings.seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+            channels.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--text") == 0) {
+            settings.text = true;
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            settings.json = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--trials N] [--sizes N,N,...] [--threads N] [--seed N]\n"
+                      << "       [--channel SPEC]... [--text] [--json]" << std::endl;
+            return 1;
+        }
+    }
+    if (!parseSizes(sizes, settings.sizes)) {
+        std::cerr << "Invalid payload sizes: " << sizes << std::endl;
+        return 1;
+    }
+
+    std::apply([&](auto... policy) {
+        (settings.detections.push_back(decltype(policy)::METHOD), ...);
+    }, DetectorPolicies{});
+    for (int m = 0; m < static_cast<int>(ErrorInjectionMethod::NONE); m++) {
+        ErrorInjectionMethod method = static_cast<ErrorInjectionMethod>(m);
+        settings.models.push_back({ErrorInjection::methodToString(method), method, ""});
+    }
+    for (const std::string& channel : channels) {
+        if (!ChannelModel::create(channel)) {
+            std::cerr << "Invalid channel model: " << channel << std::endl;
+            return 1;
+        }
+        settings.models.push_back({channel, ErrorInjectionMethod::NONE, channel});
+    }
+
+    std::cerr << "Running " << settings.trials << " trial(s) per cell on " << settings.threads
+              << " thread(s), seed " << settings.seed << "..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::unique_ptr<TrialRunner>> runners;
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < settings.threads; i++) {
+        runners.push_back(std::make_unique<TrialRunner>(settings, i));
+    }
+    for (auto& runner : runners) {
+        threads.emplace_back(&TrialRunner::run, runner.get());
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<Tally> totals(runners.front()->tallies().size());
+    uint64_t verifications = 0;
+    for (auto& runner : runners) {
+        const std::vector<Tally>& tallies = runner->tallies();
+        for (size_t i = 0; i < totals.size(); i++) {
+            totals[i].trials += tallies[i].trials;
+            totals[i].corrupted += tallies[i].corrupted;
+            totals[i].undetected += tallies[i].undetected;
+            verifications += tallies[i].trials;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printResults(settings, totals);
+    std::cerr << verifications << " verification(s) in " << seconds << " s ("
+              << static_cast<uint64_t>(verifications / seconds) << " per second)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <cstdint>
+#include <cerrno>
+#include <csignal>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// Thin wrapper around an epoll instance. Each registered descriptor carries
+// a pointer back to the object that owns it, so the caller can dispatch
+// ready events without a lookup.
+class EventLoop {
+public:
+    static constexpr int MAX_EVENTS = 256;
+
+    // Edge-triggered interest sets used by the reactor
+    static constexpr uint32_t READ_EVENTS = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    static constexpr uint32_t READ_WRITE_EVENTS = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+
+    EventLoop() : fd_(epoll_create1(EPOLL_CLOEXEC)) {}
+
+    ~EventLoop() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool valid() const { return fd_ >= 0; }
+
+    bool add(int fd, uint32_t events, void* owner) {
+        return control(EPOLL_CTL_ADD, fd, events, owner);
+    }
+
+    bool modify(int fd, uint32_t events, void* owner) {
+        return control(EPOLL_CTL_MOD, fd, events, owner);
+    }
+
+    // Closing a descriptor also removes it; this is for descriptors that
+    // stay open after leaving the loop
+    void remove(int fd) {
+        epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    // Wait for ready descriptors; returns the number of events, 0 on timeout
+    // or when a signal interrupted the wait, -1 on error. mask is the signal
+    // mask in effect while waiting: signals blocked everywhere else but
+    // unblocked here can only arrive during the wait, so a flag set by their
+    // handler is never missed between checking it and going to sleep.
+    int wait(epoll_event* events, int maxEvents, int timeoutMs, const sigset_t* mask = nullptr) {
+        int n = epoll_pwait(fd_, events, maxEvents, timeoutMs, mask);
+        if (n < 0 && errno == EINTR) return 0;
+        return n;
+    }
+
+private:
+    int fd_;
+
+    bool control(int op, int fd, uint32_t events, void* owner) {
+        epoll_event event;
+        event.events = events;
+        event.data.ptr = owner;
+        return epoll_ctl(fd_, op, fd, &event) == 0;
+    }
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,168 @@
+#ifndef INTERNET_CHECKSUM_H
+#define INTERNET_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "cpu_dispatch.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define INTERNET_CHECKSUM_X86 1
+#endif
+
+// RFC 1071 Internet checksum over big-endian 16-bit words; an odd trailing
+// byte is padded as the high byte of a final word.
+//
+// The one's complement sum does not depend on byte order, so the kernels add
+// native little-endian 32-bit halves into 64-bit accumulators, fold the
+// carries once at the end and byte-swap the 16-bit result. SSE2, AVX2 and
+// AVX-512 variants widen the same idea to 2, 4 and 8 lanes; the best one is
+// picked once at runtime (see cpu_dispatch.h).
+class InternetChecksum {
+public:
+    using SumFn = uint64_t (*)(const uint8_t*, size_t);
+
+    // Fold a wide accumulator down to a 16-bit one's complement sum
+    static uint16_t fold(uint64_t sum) {
+        sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+        sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        return static_cast<uint16_t>(sum);
+    }
+
+    static uint16_t swapBytes(uint16_t value) {
+        return static_cast<uint16_t>((value << 8) | (value >> 8));
+    }
+
+    // Little-endian sum of everything left after the 8-byte blocks
+    static uint64_t sumTail(const uint8_t* data, size_t length) {
+        uint64_t sum = 0;
+        while (length >= 2) {
+            sum += static_cast<uint64_t>(data[0]) | (static_cast<uint64_t>(data[1]) << 8);
+            data += 2;
+            length -= 2;
+        }
+        if (length) sum += data[0];
+        return sum;
+    }
+
+    // Portable path: one 64-bit load per step, split into 32-bit halves
+    static uint64_t sumScalar(const uint8_t* data, size_t length) {
+        uint64_t sum = 0;
+        while (length >= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            sum += (word & 0xFFFFFFFF) + (word >> 32);
+            data += 8;
+            length -= 8;
+        }
+        return sum + sumTail(data, length);
+    }
+
+#ifdef INTERNET_CHECKSUM_X86
+    __attribute__((target("sse2")))
+    static uint64_t sumSse2(const uint8_t* data, size_t length) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc0 = zero, acc1 = zero;
+        while (length >= 32) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+            acc0 = _mm_add_epi64(acc0, _mm_add_epi64(_mm_unpacklo_epi32(a, zero), _mm_unpackhi_epi32(a, zero)));
+            acc1 = _mm_add_epi64(acc1, _mm_add_epi64(_mm_unpacklo_epi32(b, zero), _mm_unpackhi_epi32(b, zero)));
+            data += 32;
+            length -= 32;
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+        return lanes[0] + lanes[1] + sumScalar(data, length);
+    }
+
+    __attribute__((target("avx2")))
+    static uint64_t sumAvx2(const uint8_t* data, size_t length) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc0 = zero, acc1 = zero;
+        while (length >= 64) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+            acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(_mm256_unpacklo_epi32(a, zero), _mm256_unpackhi_epi32(a, zero)));
+            acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(_mm256_unpacklo_epi32(b, zero), _mm256_unpackhi_epi32(b, zero)));
+            data += 64;
+            length -= 64;
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumScalar(data, length);
+    }
+
+    // Load 32 bytes and zero-extend the eight 32-bit halves into 64-bit lanes
+    __attribute__((target("avx512f"), always_inline))
+    static inline __m512i widen(const uint8_t* p) {
+        return _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    }
+
+    __attribute__((target("avx512f")))
+    static uint64_t sumAvx512(const uint8_t* data, size_t length) {
+        __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+        while (length >= 128) {
+            acc0 = _mm512_add_epi64(acc0, _mm512_add_epi64(widen(data), widen(data + 32)));
+            acc1 = _mm512_add_epi64(acc1, _mm512_add_epi64(widen(data + 64), widen(data + 96)));
+            data += 128;
+            length -= 128;
+        }
+        uint64_t lanes[8];
+        _mm512_storeu_si512(lanes, _mm512_add_epi64(acc0, acc1));
+        uint64_t sum = 0;
+        for (uint64_t lane : lanes) sum += lane;
+        return sum + sumScalar(data, length);
+    }
+#endif
+
+    // Summing kernel for an instruction set level
+    static SumFn sumKernel(CpuLevel level) {
+#ifdef INTERNET_CHECKSUM_X86
+        if (level >= CpuLevel::AVX512) return &sumAvx512;
+        if (level >= CpuLevel::AVX2) return &sumAvx2;
+        if (level >= CpuLevel::SSE42) return &sumSse2;
+#endif
+        (void)level;
+        return &sumScalar;
+    }
+
+    // Kernel for the level the process runs at
+    static SumFn sumKernel() {
+        static const SumFn fn = sumKernel(CpuDispatch::level());
+        return fn;
+    }
+
+    // One's complement sum of a byte range as big-endian 16-bit words
+    static uint16_t sum(const uint8_t* data, size_t length) {
+        return swapBytes(fold(sumKernel()(data, length)));
+    }
+
+    static uint16_t compute(const uint8_t* data, size_t length) {
+        return static_cast<uint16_t>(~sum(data, length));
+    }
+
+    // Incremental update (RFC 1624, eqn. 3) after the bytes at offset were
+    // overwritten in place: HC' = ~(~HC + ~m + m'). Works for any offset and
+    // length, including ranges that start or end in the middle of a word.
+    static uint16_t update(uint16_t checksum, size_t offset,
+                           const uint8_t* oldBytes, const uint8_t* newBytes, size_t length) {
+        uint16_t oldSum = sum(oldBytes, length);
+        uint16_t newSum = sum(newBytes, length);
+        if (offset & 1) {
+            // Shifting a range by one byte swaps the halves of its sum
+            oldSum = swapBytes(oldSum);
+            newSum = swapBytes(newSum);
+        }
+        uint64_t total = static_cast<uint16_t>(~checksum);
+        total += static_cast<uint16_t>(~oldSum);
+        total += newSum;
+        return static_cast<uint16_t>(~fold(total));
+    }
+};
+
+#endif // INTERNET_CHECKSUM_H
@@ -0,0 +1,157 @@
+#ifndef PACKET_FORWARDER_H
+#define PACKET_FORWARDER_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <sys/uio.h>
+#include "error_detection.h"
+#include "error_injection.h"
+#include "corruption_trace.h"
+#include "packet_frame.h"
+#include "socket_io.h"
+
+// Per-packet log: the packet as received and the corruption applied to data
+inline std::string describePacket(const Message& message, const LegacyPacket& legacy, std::string_view data,
+                           std::string_view corruptedData, size_t errors) {
+    const FrameView& frame = message.frame;
+    std::string method;
+    std::string controlInfo;
+    std::ostringstream out;
+    if (message.binary) {
+        out << "\nReceived frame from Client 1 (" << message.size << " bytes, sequence "
+            << frame.header.sequence << ")\n";
+        method = ErrorDetection::methodToString(frame.header.method);
+        controlInfo = PacketFrame::controlToText(frame.header.method, frame.controlView());
+    } else {
+        out << "\nReceived packet from Client 1: " << message.text << "\n";
+        method = std::string(legacy.method);
+        controlInfo = std::string(legacy.control);
+    }
+
+    out << "\nParsed Packet:\n";
+    out << "Data: " << data << "\n";
+    out << "Method: " << method << "\n";
+    out << "Control Info: " << controlInfo << "\n";
+
+    out << "\nError Injection Applied (" << errors << " error(s)):\n";
+    out << "Original Data: " << data << "\n";
+    out << "Corrupted Data: " << corruptedData << "\n";
+    return out.str();
+}
+
+// The server's per-packet work, apart from how the bytes move: subclasses
+// send the forwarded packets and print the log. The server's workers are
+// one kind; bench drives another to check that forwarding does not allocate.
+class PacketForwarder {
+public:
+    PacketForwarder(TraceWriter& trace, bool quiet) : trace_(trace), quiet_(quiet) {}
+    virtual ~PacketForwarder() = default;
+
+    // Corrupt one packet from a Client 1 stream and queue it for Client 2.
+    // The payload is corrupted in a copy in the sender's arena; the
+    // forwarded packet is sent as parts pointing at that copy and at the
+    // receive buffer, so nothing on this path allocates once the arena and
+    // the upstream buffer have grown to fit the traffic. A payload the
+    // channel leaves alone is not copied at all.
+    bool forwardPacket(FrameArena& arena, ChannelModel& channel, uint64_t stream, const Message& message) {
+        // Parse the packet into views over the receive buffer
+        const FrameView& frame = message.frame;
+        LegacyPacket legacy;
+        std::string_view data;
+        if (message.binary) {
+            data = frame.payloadView();
+        } else if (PacketFrame::parseLegacy(message.text, legacy)) {
+            data = legacy.data;
+        } else {
+            log("\nReceived packet from Client 1: " + std::string(message.text) + "\n");
+            std::cerr << "Invalid packet format" << std::endl;
+            return false;
+        }
+
+        // Inject error
+        arena.reset();
+        const char* corrupted = data.data();
+        size_t length = data.size();
+        size_t errors = 0;
+        CorruptionEdits* edits = nullptr;
+        if (trace_.isOpen()) {
+            edits_.clear();
+            edits = &edits_;
+        }
+        if (!channel.passesClean(length)) {
+            size_t capacity = data.size() + ErrorInjection::MAX_GROWTH;
+            char* copy = arena.allocate(capacity);
+            std::memcpy(copy, data.data(), data.size());
+            errors = channel.apply(copy, length, capacity, edits);
+            corrupted = copy;
+        }
+        if (edits) {
+            trace_.append(stream, message.binary ? frame.header.sequence : 0, data.size(), errors, edits_);
+        }
+        std::string_view corruptedData(corrupted, length);
+        if (!quiet_) log(describePacket(message, legacy, data, corruptedData, errors));
+
+        // Create new packet with corrupted data (keep same method and control info)
+        bool queued;
+        size_t size;
+        if (message.binary && corrupted == data.data()) {
+            // Untouched: the frame goes out as it came in
+            iovec whole = {const_cast<uint8_t*>(frame.payload - PacketFrame::HEADER_SIZE), message.size};
+            size = message.size;
+            queued = sendPersistent(&whole, 1);
+        } else if (message.binary) {
+            std::string_view control = frame.controlView();
+            uint8_t* header = reinterpret_cast<uint8_t*>(arena.allocate(PacketFrame::HEADER_SIZE));
+            PacketFrame::writeHeader(header, frame.header.method, frame.header.sequence, length, control.size(),
+                                     frame.header.flags);
+            iovec parts[3] = {
+                {header, PacketFrame::HEADER_SIZE},
+                {const_cast<char*>(corrupted), length},
+                {const_cast<char*>(control.data()), control.size()}
+            };
+            size = PacketFrame::HEADER_SIZE + length + control.size();
+            queued = sendPersistent(parts, 3);
+        } else {
+            char separator = '|';
+            iovec parts[5] = {
+                {const_cast<char*>(corrupted), length},
+                {&separator, 1},
+                {const_cast<char*>(legacy.method.data()), legacy.method.size()},
+                {&separator, 1},
+                {const_cast<char*>(legacy.control.data()), legacy.control.size()}
+            };
+            size = length + legacy.method.size() + legacy.control.size() + 2;
+            queued = sendOneShot(parts, 5);
+        }
+
+        if (!queued) {
+            std::cerr << "Send to Client 2 failed" << std::endl;
+            return false;
+        }
+        if (!quiet_) log("Corrupted packet forwarded to Client 2 (" + std::to_string(size) + " bytes)\n");
+        return true;
+    }
+
+protected:
+    TraceWriter& trace_;
+    CorruptionEdits edits_;     // Scratch for the trace, reused across packets
+    bool quiet_;
+
+    void log(const std::string& text) {
+        if (!quiet_) output(text);
+    }
+
+    virtual void output(const std::string& text) = 0;
+
+    // Queue a binary frame on the persistent link to Client 2, or a legacy
+    // packet on a connection of its own; false if Client 2 is unreachable.
+    // The parts are only valid during the call.
+    virtual bool sendPersistent(const iovec* parts, int count) = 0;
+    virtual bool sendOneShot(const iovec* parts, int count) = 0;
+};
+
+#endif // PACKET_FORWARDER_H
@@ -0,0 +1,295 @@
+#ifndef PACKET_FRAME_H
+#define PACKET_FRAME_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstdlib>
+#include "error_detection.h"
+
+// Binary frame layout (all integers big-endian):
+//   offset  0  magic            4 bytes  "EDCF"
+//   offset  4  version          1 byte
+//   offset  5  method id        1 byte   ErrorDetectionMethod value
+//   offset  6  flags            2 bytes  FLAG_FILE_CHUNK or zero
+//   offset  8  sequence number  8 bytes  byte offset in the file for a chunk
+//   offset 16  payload length   4 bytes
+//   offset 20  control length   4 bytes
+//   offset 24  payload, followed by the control field
+//
+// Integer control values (parity, CRCs, checksum, Hamming count) are sent as
+// fixed-width raw bytes. 2D parity sends its control string as-is and SECDED
+// sends one check byte per payload byte.
+//
+// The legacy text packet DATA|METHOD|CONTROL_INFORMATION is still understood;
+// a receiver tells the two apart by the magic.
+
+enum class FrameStatus {
+    OK,
+    INCOMPLETE,     // Need more bytes before the frame can be parsed
+    BAD_MAGIC,
+    BAD_VERSION,
+    BAD_METHOD,
+    TOO_LARGE       // Payload or control longer than the configured maximum
+};
+
+struct FrameHeader {
+    uint8_t version = 1;
+    ErrorDetectionMethod method = ErrorDetectionMethod::PARITY;
+    uint16_t flags = 0;
+    uint64_t sequence = 0;
+    uint32_t payloadLength = 0;
+    uint32_t controlLength = 0;
+};
+
+// Parsed frame pointing into the receive buffer; nothing is copied
+struct FrameView {
+    FrameHeader header;
+    const uint8_t* payload = nullptr;
+    const uint8_t* control = nullptr;
+
+    size_t size() const;
+
+    std::string_view payloadView() const {
+        return std::string_view(reinterpret_cast<const char*>(payload), header.payloadLength);
+    }
+
+    std::string_view controlView() const {
+        return std::string_view(reinterpret_cast<const char*>(control), header.controlLength);
+    }
+};
+
+// Legacy text packet, also as views into the receive buffer
+struct LegacyPacket {
+    std::string_view data;
+    std::string_view method;
+    std::string_view control;
+};
+
+class PacketFrame {
+public:
+    static constexpr uint32_t MAGIC = 0x45444346; // "EDCF"
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 24;
+    static constexpr size_t DEFAULT_MAX_PAYLOAD = 64 * 1024 * 1024;
+
+    // The payload is one chunk of a file (client1 --file), and the sequence
+    // number is where the chunk starts in it
+    static constexpr uint16_t FLAG_FILE_CHUNK = 0x0001;
+
+    static uint16_t readBE16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static uint32_t readBE32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    static uint64_t readBE64(const uint8_t* p) {
+        return (static_cast<uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+    }
+
+    static void writeBE(uint8_t* p, uint64_t value, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) {
+            p[i] = static_cast<uint8_t>(value);
+            value >>= 8;
+        }
+    }
+
+    // True if the buffer starts with the binary frame magic
+    static bool isFrame(const uint8_t* buffer, size_t length) {
+        return length >= 4 && readBE32(buffer) == MAGIC;
+    }
+
+    // Parse one frame at the start of buffer without copying
+    static FrameStatus parse(const uint8_t* buffer, size_t length, FrameView& frame,
+                             size_t maxPayload = DEFAULT_MAX_PAYLOAD) {
+        if (length < 4) return FrameStatus::INCOMPLETE;
+        if (readBE32(buffer) != MAGIC) return FrameStatus::BAD_MAGIC;
+        if (length < HEADER_SIZE) return FrameStatus::INCOMPLETE;
+
+        FrameHeader& header = frame.header;
+        header.version = buffer[4];
+        if (header.version != VERSION) return FrameStatus::BAD_VERSION;
+        if (buffer[5] > static_cast<uint8_t>(ErrorDetectionMethod::HAMMING_SECDED)) {
+            return FrameStatus::BAD_METHOD;
+        }
+        header.method = static_cast<ErrorDetectionMethod>(buffer[5]);
+        header.flags = readBE16(buffer + 6);
+        header.sequence = readBE64(buffer + 8);
+        header.payloadLength = readBE32(buffer + 16);
+        header.controlLength = readBE32(buffer + 20);
+
+        // The control field is never longer than SECDED's byte per byte
+        size_t maxControl = maxPayload > 16 ? maxPayload : 16;
+        if (header.payloadLength > maxPayload || header.controlLength > maxControl) {
+            return FrameStatus::TOO_LARGE;
+        }
+        if (length < frame.size()) return FrameStatus::INCOMPLETE;
+
+        frame.payload = buffer + HEADER_SIZE;
+        frame.control = frame.payload + header.payloadLength;
+        return FrameStatus::OK;
+    }
+
+    static void writeHeader(uint8_t* out, const FrameHeader& header) {
+        writeBE(out, MAGIC, 4);
+        out[4] = header.version;
+        out[5] = static_cast<uint8_t>(header.method);
+        writeBE(out + 6, header.flags, 2);
+        writeBE(out + 8, header.sequence, 8);
+        writeBE(out + 16, header.payloadLength, 4);
+        writeBE(out + 20, header.controlLength, 4);
+    }
+
+    // Header of a frame whose payload and control field are sent separately
+    static void writeHeader(uint8_t* out, ErrorDetectionMethod method, uint64_t sequence,
+                            size_t payloadLength, size_t controlLength, uint16_t flags = 0) {
+        FrameHeader header;
+        header.version = VERSION;
+        header.method = method;
+        header.flags = flags;
+        header.sequence = sequence;
+        header.payloadLength = static_cast<uint32_t>(payloadLength);
+        header.controlLength = static_cast<uint32_t>(controlLength);
+        writeHeader(out, header);
+    }
+
+    // Append a complete frame to out
+    static void build(std::string& out, ErrorDetectionMethod method, uint64_t sequence,
+                      std::string_view payload, std::string_view control) {
+        size_t start = out.size();
+        out.resize(start + HEADER_SIZE);
+        writeHeader(reinterpret_cast<uint8_t*>(&out[start]), method, sequence, payload.size(), control.size());
+        out.append(payload.data(), payload.size());
+        out.append(control.data(), control.size());
+    }
+
+    // Fixed byte width of a method's integer control value, 0 if variable
+    static int controlWidth(ErrorDetectionMethod method) {
+        switch (method) {
+            case ErrorDetectionMethod::PARITY: return 1;
+            case ErrorDetectionMethod::CRC16: return 2;
+            case ErrorDetectionMethod::HAMMING: return 8;
+            case ErrorDetectionMethod::CHECKSUM: return 2;
+            case ErrorDetectionMethod::CRC16_CCITT: return 2;
+            case ErrorDetectionMethod::CRC32: return 4;
+            case ErrorDetectionMethod::CRC32C: return 4;
+            case ErrorDetectionMethod::CRC64: return 8;
+            default: return 0;
+        }
+    }
+
+    // Minimum hex digits of the text form of an integer control value
+    static int controlDigits(ErrorDetectionMethod method) {
+        switch (method) {
+            case ErrorDetectionMethod::CRC32:
+            case ErrorDetectionMethod::CRC32C: return 8;
+            case ErrorDetectionMethod::CRC64: return 16;
+            default: return 4;
+        }
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    // Convert the text control information produced by ErrorDetection into
+    // the raw bytes carried by a binary frame
+    static std::string controlToBytes(ErrorDetectionMethod method, std::string_view text) {
+        int width = controlWidth(method);
+        if (method == ErrorDetectionMethod::PARITY) {
+            return std::string(1, text == "1" ? '\1' : '\0');
+        }
+        if (width > 0) {
+            uint64_t value = 0;
+            for (char c : text) {
+                int digit = hexValue(c);
+                if (digit < 0) break;
+                value = (value << 4) | static_cast<uint64_t>(digit);
+            }
+            std::string bytes(width, '\0');
+            writeBE(reinterpret_cast<uint8_t*>(&bytes[0]), value, width);
+            return bytes;
+        }
+        if (method == ErrorDetectionMethod::HAMMING_SECDED) {
+            std::string bytes(text.size() / 2, '\0');
+            for (size_t i = 0; i < bytes.size(); i++) {
+                int hi = hexValue(text[2 * i]);
+                int lo = hexValue(text[2 * i + 1]);
+                bytes[i] = static_cast<char>(((hi < 0 ? 0 : hi) << 4) | (lo < 0 ? 0 : lo));
+            }
+            return bytes;
+        }
+        return std::string(text);
+    }
+
+    // Inverse of controlToBytes, for display and legacy forwarding
+    static std::string controlToText(ErrorDetectionMethod method, std::string_view bytes) {
+        int width = controlWidth(method);
+        if (method == ErrorDetectionMethod::PARITY) {
+            return (!bytes.empty() && bytes[0] != 0) ? "1" : "0";
+        }
+        if (width > 0) {
+            uint64_t value = 0;
+            for (char c : bytes) {
+                value = (value << 8) | static_cast<uint8_t>(c);
+            }
+            return ErrorDetection::toHex(value, controlDigits(method));
+        }
+        if (method == ErrorDetectionMethod::HAMMING_SECDED) {
+            static const char HEX[] = "0123456789ABCDEF";
+            std::string text(bytes.size() * 2, '0');
+            for (size_t i = 0; i < bytes.size(); i++) {
+                uint8_t b = static_cast<uint8_t>(bytes[i]);
+                text[2 * i] = HEX[b >> 4];
+                text[2 * i + 1] = HEX[b & 0xF];
+            }
+            return text;
+        }
+        return std::string(bytes);
+    }
+
+    // Split a legacy DATA|METHOD|CONTROL_INFORMATION packet
+    static bool parseLegacy(std::string_view packet, LegacyPacket& out) {
+        size_t firstPipe = packet.find('|');
+        if (firstPipe == std::string_view::npos) return false;
+        size_t secondPipe = packet.find('|', firstPipe + 1);
+        if (secondPipe == std::string_view::npos) return false;
+
+        out.data = packet.substr(0, firstPipe);
+        out.method = packet.substr(firstPipe + 1, secondPipe - firstPipe - 1);
+        out.control = packet.substr(secondPipe + 1);
+        return true;
+    }
+
+    static std::string buildLegacy(std::string_view data, std::string_view method,
+                                   std::string_view control) {
+        std::string packet;
+        packet.reserve(data.size() + method.size() + control.size() + 2);
+        packet.append(data).append(1, '|').append(method).append(1, '|').append(control);
+        return packet;
+    }
+
+    static const char* statusToString(FrameStatus status) {
+        switch (status) {
+            case FrameStatus::OK: return "OK";
+            case FrameStatus::INCOMPLETE: return "incomplete frame";
+            case FrameStatus::BAD_MAGIC: return "bad magic";
+            case FrameStatus::BAD_VERSION: return "unsupported version";
+            case FrameStatus::BAD_METHOD: return "unknown method id";
+            case FrameStatus::TOO_LARGE: return "frame too large";
+            default: return "unknown";
+        }
+    }
+};
+
+inline size_t FrameView::size() const {
+    return PacketFrame::HEADER_SIZE + header.payloadLength + header.controlLength;
+}
+
+#endif // PACKET_FRAME_H
@@ -0,0 +1,245 @@
+#ifndef PARITY_MATRIX_H
+#define PARITY_MATRIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Packed bit vector, most significant bit of each word first
+struct PackedBits {
+    std::vector<uint64_t> words;
+    size_t size = 0;
+
+    void clear() {
+        words.clear();
+        size = 0;
+    }
+
+    // Append the low `count` bits of value (1..64), highest bit first
+    void append(uint64_t value, int count) {
+        if (count < 64) value &= (1ULL << count) - 1;
+        int used = static_cast<int>(size % 64);
+        if (used == 0) {
+            words.push_back(value << (64 - count));
+        } else {
+            int room = 64 - used;
+            if (count <= room) {
+                words.back() |= value << (room - count);
+            } else {
+                words.back() |= value >> (count - room);
+                words.push_back(value << (64 - (count - room)));
+            }
+        }
+        size += count;
+    }
+
+    // Read `count` bits (1..64) starting at bit position pos; bits before
+    // the start or past the end read as zero
+    uint64_t read(long long pos, int count) const {
+        uint64_t result = 0;
+        for (int i = 0; i < count; i++) {
+            long long p = pos + i;
+            bool bit = p >= 0 && static_cast<size_t>(p) < size &&
+                       ((words[p / 64] >> (63 - p % 64)) & 1);
+            result = (result << 1) | bit;
+        }
+        return result;
+    }
+};
+
+// 2D parity over the MSB-first bit stream of a payload laid out column by
+// column: bit i goes to row i % rows, column i / rows, and the last column is
+// zero-padded. The payload may arrive in any number of update() calls;
+// finish() returns row and column parities as packed bit vectors.
+class ParityMatrix {
+public:
+    explicit ParityMatrix(size_t rows = 8)
+        : rows_(rows < 1 ? 1 : rows), rowWords_((rows_ + 63) / 64), rowAcc_(rowWords_, 0) {}
+
+    size_t rows() const { return rows_; }
+
+    // Transpose an 8x8 bit matrix held one row per byte, top row in the most
+    // significant byte (Hacker's Delight, 7-3)
+    static uint64_t transpose8x8(uint64_t x) {
+        uint64_t t;
+        t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+        x = x ^ t ^ (t << 7);
+        t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+        x = x ^ t ^ (t << 14);
+        t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+        x = x ^ t ^ (t << 28);
+        return x;
+    }
+
+    static uint64_t loadBigEndian(const uint8_t* p) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        return __builtin_bswap64(word);
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        if (rows_ == 8) {
+            updateByteColumns(data, length);
+        } else {
+            updateGeneric(data, length);
+        }
+    }
+
+    void finish(PackedBits& rowParity, PackedBits& colParity) {
+        rowParity.clear();
+        if (rows_ == 8) {
+            uint64_t acc = rowAcc_[0];
+            acc ^= acc >> 32;
+            acc ^= acc >> 16;
+            acc ^= acc >> 8;
+            rowParity.append(acc & 0xFF, 8);
+        } else {
+            // Remaining bits form a zero-padded final column
+            // (take() zeroes available_, so read the count first)
+            if (available_ > 0) {
+                int count = available_;
+                addSegment(take(count) << (segmentSize() - count));
+            }
+            if (colFill_ > 0) {
+                colParity_.append(colOnes_ & 1, 1);
+            }
+            size_t remaining = rows_;
+            for (size_t w = 0; w < rowWords_; w++) {
+                int count = remaining >= 64 ? 64 : static_cast<int>(remaining);
+                rowParity.append(rowAcc_[w], count);
+                remaining -= count;
+            }
+        }
+        // Swap rather than move so both vectors keep their capacity
+        std::swap(colParity, colParity_);
+        reset();
+    }
+
+    // Discard any partial input
+    void reset() {
+        std::fill(rowAcc_.begin(), rowAcc_.end(), 0);
+        colParity_.clear();
+        window_ = 0;
+        available_ = 0;
+        colFill_ = 0;
+        colOnes_ = 0;
+    }
+
+    static void compute(const uint8_t* data, size_t length, size_t rows,
+                        PackedBits& rowParity, PackedBits& colParity) {
+        ParityMatrix matrix(rows);
+        matrix.update(data, length);
+        matrix.finish(rowParity, colParity);
+    }
+
+    // Bit-at-a-time reference for the same layout, for the self-check
+    static void computeScalar(const uint8_t* data, size_t length, size_t rows,
+                              PackedBits& rowParity, PackedBits& colParity) {
+        if (rows < 1) rows = 1;
+        rowParity.clear();
+        colParity.clear();
+        std::vector<uint8_t> rowBits(rows, 0);
+        int column = 0;
+        size_t bits = length * 8;
+        for (size_t i = 0; i < bits; i++) {
+            int bit = (data[i / 8] >> (7 - i % 8)) & 1;
+            rowBits[i % rows] ^= bit;
+            column ^= bit;
+            if (i % rows == rows - 1) {
+                colParity.append(column, 1);
+                column = 0;
+            }
+        }
+        if (bits % rows != 0) colParity.append(column, 1);
+        for (uint8_t bit : rowBits) rowParity.append(bit, 1);
+    }
+
+private:
+    size_t rows_;
+    size_t rowWords_;
+    std::vector<uint64_t> rowAcc_;
+    PackedBits colParity_;
+
+    // Generic layout state: 128-bit left-aligned window over the stream and
+    // progress through the current column
+    unsigned __int128 window_ = 0;
+    int available_ = 0;
+    size_t colFill_ = 0;
+    int colOnes_ = 0;
+
+    // Default layout: every column is one byte, every row one bit position.
+    // Eight columns at a time are transposed so that XOR-ing the resulting
+    // row bytes yields the eight column parities already in output order.
+    void updateByteColumns(const uint8_t* data, size_t length) {
+        uint64_t rowAcc = rowAcc_[0];
+        while (length >= 8) {
+            uint64_t columns = loadBigEndian(data);
+            rowAcc ^= columns;
+            uint64_t t = transpose8x8(columns);
+            t ^= t >> 32;
+            t ^= t >> 16;
+            t ^= t >> 8;
+            colParity_.append(t & 0xFF, 8);
+            data += 8;
+            length -= 8;
+        }
+        while (length--) {
+            rowAcc ^= *data;
+            colParity_.append(__builtin_parity(*data++), 1);
+        }
+        rowAcc_[0] = rowAcc;
+    }
+
+    // Bits still needed for the current 64-row segment of the column
+    int segmentSize() const {
+        size_t left = rows_ - colFill_;
+        return left >= 64 ? 64 : static_cast<int>(left);
+    }
+
+    uint64_t take(int count) {
+        uint64_t bits = static_cast<uint64_t>(window_ >> (128 - count));
+        window_ <<= count;
+        available_ -= count;
+        return bits;
+    }
+
+    void addSegment(uint64_t bits) {
+        rowAcc_[colFill_ / 64] ^= bits;
+        colOnes_ ^= __builtin_popcountll(bits);
+        colFill_ += segmentSize();
+        if (colFill_ == rows_) {
+            colParity_.append(colOnes_ & 1, 1);
+            colFill_ = 0;
+            colOnes_ = 0;
+        }
+    }
+
+    // Any row count: each column is the next `rows` bits of the stream, taken
+    // up to 64 at a time. Row parity XOR-accumulates columns word by word,
+    // column parity is the popcount parity of each column.
+    void updateGeneric(const uint8_t* data, size_t length) {
+        for (;;) {
+            if (available_ <= 64 && length >= 8) {
+                window_ |= static_cast<unsigned __int128>(loadBigEndian(data)) << (64 - available_);
+                available_ += 64;
+                data += 8;
+                length -= 8;
+            } else if (available_ <= 120 && length > 0) {
+                window_ |= static_cast<unsigned __int128>(*data++) << (120 - available_);
+                available_ += 8;
+                length--;
+            }
+            int need = segmentSize();
+            if (available_ < need) {
+                if (length == 0) return;
+                continue;
+            }
+            addSegment(take(need));
+        }
+    }
+};
+
+#endif // PARITY_MATRIX_H
@@ -1,153 +1,1440 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
 #include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include "error_detection.h"
 #include "error_injection.h"
+#include "corruption_trace.h"
+#include "packet_frame.h"
+#include "packet_forwarder.h"
+#include "socket_io.h"
+#include "event_loop.h"
+#include "shm_ring.h"
+#include "udp_io.h"
+#include "uring_loop.h"
 
 #define SERVER_PORT 8080
+#define CLIENT2_IP "127.0.0.1"
 #define CLIENT2_PORT 8081
+#define LISTEN_BACKLOG SOMAXCONN
+#define MAX_MESSAGE_SIZE (64 * 1024 * 1024)
+#define SENDER_BUFFER_SIZE (4 * 1024)
+#define UPSTREAM_HIGH_WATERMARK (16 * 1024 * 1024)
+#define UPSTREAM_LOW_WATERMARK (4 * 1024 * 1024)
+#define PASS_THROUGH_MIN_FRAME (16 * 1024)
+#define RING_TIMEOUT_MS 200
+#define UDP_TIMEOUT_MS 200
+#define UDP_PEER_IDLE_SECONDS 60
 
-int main() {
-    // Create listening socket for Client 1
-    int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenSocket < 0) {
-        std::cerr << "Socket creation failed" << std::endl;
-        return 1;
+enum class ConnectionKind { LISTENER, SENDER, UPSTREAM, SHUTDOWN };
+
+// Workers share stdout; each message is written whole so lines never interleave
+std::mutex outputMutex;
+
+void writeOutput(const std::string& text) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << text << std::flush;
+}
+
+// Hands out a channel model to every Client 1 connection. Connections are
+// numbered as streams in accept order and each gets a generator seeded from
+// the master seed and its stream number, so a run with a given seed corrupts
+// the same way again as long as senders connect in the same order.
+struct ChannelSource {
+    std::string spec;
+    uint64_t seed = 0;
+    std::shared_ptr<const CorruptionTrace> replay;    // Re-apply a recorded run instead
+    TraceWriter trace;
+    std::atomic<uint64_t> nextStream{0};
+
+    std::unique_ptr<ChannelModel> open(uint64_t& stream) {
+        stream = nextStream.fetch_add(1, std::memory_order_relaxed);
+        if (replay) return std::make_unique<ReplayChannel>(replay, stream);
+        return ChannelModel::create(spec, ErrorInjection::deriveSeed(seed, stream));
     }
+};
 
-    // Set socket option to reuse address
-    int opt = 1;
-    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+// Anything registered with the event loop
+struct Connection {
+    ConnectionKind kind;
+    int fd;
 
-    // Setup server address
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(SERVER_PORT);
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    Connection(ConnectionKind kind, int fd) : kind(kind), fd(fd) {}
+    virtual ~Connection() = default;
+};
 
-    // Bind socket
-    if (bind(listenSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Bind failed" << std::endl;
-        close(listenSocket);
-        return 1;
+// Client 1 connection with its own receive buffer and scratch arena. A fed
+// connection's reader gets its bytes from io_uring instead of recv().
+struct SenderConnection : Connection {
+    MessageReader reader;
+    FrameArena arena;
+    std::unique_ptr<ChannelModel> channel;
+    uint64_t stream = 0;
+    size_t forwarded = 0;
+    size_t passThrough = 0;     // Bytes of a spliced frame still in the socket
+    bool paused = false;
+
+    explicit SenderConnection(int fd, bool fed = false)
+        : Connection(ConnectionKind::SENDER, fd), reader(fed ? -1 : fd, MAX_MESSAGE_SIZE, SENDER_BUFFER_SIZE) {}
+};
+
+// Connection to Client 2 with its own send buffer. The persistent link
+// carries every binary frame; legacy packets are delimited by EOF, so each
+// one gets a one-shot connection that closes once it is written.
+struct UpstreamConnection : Connection {
+    WriteBuffer out;
+    bool persistent;
+    bool connecting = false;
+
+    explicit UpstreamConnection(bool persistent)
+        : Connection(ConnectionKind::UPSTREAM, -1), persistent(persistent) {}
+};
+
+// One reactor thread: multiplexes its share of the Client 1 connections and
+// its own upstream links to Client 2. Workers share only the stream counter
+// and the trace: each has its own SO_REUSEPORT listener and upstream link.
+// PacketForwarder turns packets into corrupted ones; subclasses move the
+// bytes, with epoll (EpollWorker) or io_uring (UringWorker).
+class Worker : public PacketForwarder {
+public:
+    Worker(ChannelSource& channels, bool quiet) : PacketForwarder(channels.trace, quiet), channels_(channels) {}
+
+    virtual bool start(uint16_t port, int backlog) = 0;
+    virtual void run() = 0;
+
+protected:
+    ChannelSource& channels_;
+
+    void output(const std::string& text) override { writeOutput(text); }
+
+    bool forwardFrom(SenderConnection* sender, const Message& message) {
+        return forwardPacket(sender->arena, *sender->channel, sender->stream, message);
     }
+};
 
-    // Listen for connections
-    if (listen(listenSocket, 5) < 0) {
-        std::cerr << "Listen failed" << std::endl;
-        close(listenSocket);
-        return 1;
+// Edge-triggered epoll reactor. With --quiet, a frame of at least
+// PASS_THROUGH_MIN_FRAME bytes that the channel leaves untouched is spliced
+// from the sender's socket through a pipe to Client 2 without entering user
+// space; the per-packet log needs the payload, so it rules this out.
+class EpollWorker : public Worker {
+public:
+    EpollWorker(int shutdownFd, ChannelSource& channels, bool quiet)
+        : Worker(channels, quiet), listener_(ConnectionKind::LISTENER, -1), link_(true),
+          shutdown_(ConnectionKind::SHUTDOWN, shutdownFd) {}
+
+    ~EpollWorker() override {
+        for (auto& entry : connections_) close(entry.first);
+        if (link_.fd >= 0) close(link_.fd);
+        if (listener_.fd >= 0) close(listener_.fd);
+        if (spareFd_ >= 0) close(spareFd_);
     }
 
-    std::cout << "=== Server: Intermediate Node + Data Corruptor ===" << std::endl;
-    std::cout << "Waiting for Client 1 on port " << SERVER_PORT << "..." << std::endl;
-
-    // Accept connection from Client 1
-    sockaddr_in client1Addr;
-    socklen_t client1AddrLen = sizeof(client1Addr);
-    int client1Socket = accept(listenSocket, (sockaddr*)&client1Addr, &client1AddrLen);
-    if (client1Socket < 0) {
-        std::cerr << "Accept failed" << std::endl;
-        close(listenSocket);
-        return 1;
+    bool start(uint16_t port, int backlog) override {
+        if (!loop_.valid()) {
+            std::cerr << "epoll creation failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Create listening socket for Client 1
+        listener_.fd = createListenSocket(port, backlog, true);
+        if (listener_.fd < 0 || !setNonBlocking(listener_.fd) ||
+            !loop_.add(listener_.fd, EventLoop::READ_EVENTS, &listener_)) {
+            std::cerr << "Listen on port " << port << " failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Level-triggered and never read, so it wakes every worker
+        if (!loop_.add(shutdown_.fd, EPOLLIN, &shutdown_)) {
+            std::cerr << "epoll registration failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Held in reserve so a connection can still be accepted and refused
+        // when the process runs out of descriptors
+        spareFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+        if (quiet_ && !pipe_.open()) {
+            std::cerr << "Pipe creation failed, frames are copied: " << std::strerror(errno) << std::endl;
+        }
+        return true;
     }
 
-    std::cout << "Client 1 connected!" << std::endl;
+    void run() override {
+        epoll_event events[EventLoop::MAX_EVENTS];
+        while (running_) {
+            int n = loop_.wait(events, EventLoop::MAX_EVENTS, -1);
+            if (n < 0) {
+                std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
 
-    // Receive packet from Client 1
-    char buffer[4096];
-    ssize_t bytesReceived = recv(client1Socket, buffer, sizeof(buffer) - 1, 0);
-    if (bytesReceived < 0 || bytesReceived == 0) {
-        std::cerr << "Receive failed" << std::endl;
-        close(client1Socket);
-        close(listenSocket);
-        return 1;
+            for (int i = 0; i < n; i++) {
+                Connection* connection = static_cast<Connection*>(events[i].data.ptr);
+                if (connection->fd < 0) continue; // Closed earlier in this batch
+
+                switch (connection->kind) {
+                    case ConnectionKind::LISTENER:
+                        acceptAll();
+                        break;
+                    case ConnectionKind::SENDER:
+                        readSender(static_cast<SenderConnection*>(connection));
+                        break;
+                    case ConnectionKind::UPSTREAM:
+                        handleUpstream(static_cast<UpstreamConnection*>(connection), events[i].events);
+                        break;
+                    case ConnectionKind::SHUTDOWN:
+                        running_ = false;
+                        break;
+                }
+            }
+
+            // Connections closed in this batch may still have had events in it
+            closed_.clear();
+        }
+
+        flushOnShutdown();
     }
 
-    buffer[bytesReceived] = '\0';
-    std::string packet(buffer);
+private:
+    EventLoop loop_;
+    Connection listener_;
+    UpstreamConnection link_;
+    Connection shutdown_;
+    bool running_ = true;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::vector<std::unique_ptr<Connection>> closed_;
+    std::vector<int> paused_;
+    bool resuming_ = false;
+    int spareFd_ = -1;
+    SplicePipe pipe_;                       // Pass-through bytes queued behind link_.out
+    SenderConnection* splicing_ = nullptr;  // Sender with a frame part way through pipe_
 
-    std::cout << "\nReceived packet from Client 1: " << packet << std::endl;
+    void acceptAll() {
+        for (;;) {
+            int fd = accept4(listener_.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                if ((errno == EMFILE || errno == ENFILE) && refuseConnection()) continue;
+                std::cerr << "Accept failed: " << std::strerror(errno) << std::endl;
+                return;
+            }
 
-    // Parse packet: DATA|METHOD|CONTROL_INFORMATION
-    size_t firstPipe = packet.find('|');
-    size_t secondPipe = packet.find('|', firstPipe + 1);
+            auto sender = std::make_unique<SenderConnection>(fd);
+            sender->channel = channels_.open(sender->stream);
+            if (pipe_.valid()) sender->reader.setPassThrough(PASS_THROUGH_MIN_FRAME);
+            if (!loop_.add(fd, EventLoop::READ_EVENTS, sender.get())) {
+                std::cerr << "epoll registration failed: " << std::strerror(errno) << std::endl;
+                close(fd);
+                continue;
+            }
+            uint64_t stream = sender->stream;
+            connections_[fd] = std::move(sender);
+            log("Client 1 connected! (stream " + std::to_string(stream) + ")\n");
+        }
+    }
 
-    if (firstPipe == std::string::npos || secondPipe == std::string::npos) {
-        std::cerr << "Invalid packet format" << std::endl;
-        close(client1Socket);
-        close(listenSocket);
-        return 1;
+    // Out of descriptors: accept the pending connection on the spare one and
+    // close it at once, otherwise the edge-triggered listener never fires again
+    bool refuseConnection() {
+        if (spareFd_ < 0) return false;
+        close(spareFd_);
+        int fd = accept(listener_.fd, nullptr, nullptr);
+        if (fd >= 0) close(fd);
+        spareFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        std::cerr << "Too many open files, Client 1 connection refused" << std::endl;
+        return fd >= 0;
     }
 
-    std::string data = packet.substr(0, firstPipe);
-    std::string method = packet.substr(firstPipe + 1, secondPipe - firstPipe - 1);
-    std::string controlInfo = packet.substr(secondPipe + 1);
+    // Drain the socket, as edge-triggered readiness is reported only once
+    void readSender(SenderConnection* sender) {
+        // Running now, so a stale entry in paused_ must not run it again
+        sender->paused = false;
+        Message message;
+        for (;;) {
+            // Finish moving a pass-through frame before reading past it
+            if (sender->passThrough > 0 && !continuePassThrough(sender)) return;
 
-    std::cout << "\nParsed Packet:" << std::endl;
-    std::cout << "Data: " << data << std::endl;
-    std::cout << "Method: " << method << std::endl;
-    std::cout << "Control Info: " << controlInfo << std::endl;
+            // Stop reading while Client 2 is behind or another sender's frame
+            // is part way through the pipe; resumeSenders() picks up again
+            if (link_.out.size() > UPSTREAM_HIGH_WATERMARK || !pipe_.empty() || splicing_) {
+                pause(sender);
+                return;
+            }
 
-    // Inject error
-    std::string corruptedData = ErrorInjection::injectError(data);
-    
-    std::cout << "\nError Injection Applied:" << std::endl;
-    std::cout << "Original Data: " << data << std::endl;
-    std::cout << "Corrupted Data: " << corruptedData << std::endl;
+            ReadStatus readStatus = sender->reader.next(message);
+            if (readStatus == ReadStatus::HEADER) {
+                if (startPassThrough(sender, message)) continue;
+                readStatus = sender->reader.next(message);
+            }
+            if (readStatus == ReadStatus::OK) {
+                if (forwardFrom(sender, message)) sender->forwarded++;
+                continue;
+            }
+            if (readStatus == ReadStatus::WOULD_BLOCK) return;
+            if (readStatus != ReadStatus::CLOSED) {
+                std::cerr << "Receive failed: " << MessageReader::statusToString(readStatus) << std::endl;
+            }
+            log("\nClient 1 disconnected (" + std::to_string(sender->forwarded) + " packet(s) forwarded)\n");
+            closeConnection(sender);
+            return;
+        }
+    }
 
-    // Create new packet with corrupted data (keep same method and control info)
-    std::string corruptedPacket = corruptedData + "|" + method + "|" + controlInfo;
+    void pause(SenderConnection* sender) {
+        if (sender->paused) return;
+        sender->paused = true;
+        paused_.push_back(sender->fd);
+    }
 
-    // Close connection with Client 1
-    close(client1Socket);
+    // Forward a large frame the channel leaves untouched from the sender's
+    // socket to Client 2 through pipe_, without reading it. Declines (false)
+    // unless the link is up with nothing queued ahead of the frame.
+    bool startPassThrough(SenderConnection* sender, const Message& message) {
+        const FrameHeader& header = message.frame.header;
+        if (link_.fd < 0 || link_.connecting || !link_.out.empty()) return false;
+        if (!sender->channel->passesClean(header.payloadLength)) return false;
+        if (channels_.trace.isOpen()) {
+            edits_.clear();
+            channels_.trace.append(sender->stream, header.sequence, header.payloadLength, 0, edits_);
+        }
 
-    // Connect to Client 2
-    int client2Socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (client2Socket < 0) {
-        std::cerr << "Socket creation for Client 2 failed" << std::endl;
-        close(listenSocket);
-        return 1;
+        // What the reader already holds goes first
+        std::string_view prefix = sender->reader.takeFrame();
+        sender->passThrough = message.size - prefix.size();
+        sender->forwarded++;
+        splicing_ = sender;
+        if (!pipe_.write(prefix.data(), prefix.size())) {
+            std::cerr << "Pass-through to Client 2 failed: " << std::strerror(errno) << std::endl;
+            dropUpstream(&link_);
+        }
+        return true;
+    }
+
+    // Splice the rest of a pass-through frame into the pipe and on to
+    // Client 2; false until all of it has left the sender's socket
+    bool continuePassThrough(SenderConnection* sender) {
+        while (sender->passThrough > 0) {
+            ssize_t n = pipe_.fromSocket(sender->fd, sender->passThrough);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                std::cerr << "Receive failed: "
+                          << MessageReader::statusToString(n == 0 ? ReadStatus::TRUNCATED : ReadStatus::ERROR)
+                          << std::endl;
+                log("\nClient 1 disconnected (" + std::to_string(sender->forwarded) + " packet(s) forwarded)\n");
+                closeConnection(sender);
+                // Client 2 has part of the frame; a new link makes it drop that
+                if (link_.fd >= 0) {
+                    dropUpstream(&link_);
+                } else {
+                    resumeSenders();
+                }
+                return false;
+            }
+            bool queued = !pipe_.empty();
+            if (n > 0) sender->passThrough -= static_cast<size_t>(n);
+            flushPipe();
+            if (n < 0) {
+                // A full pipe that has drained since can take more at once;
+                // otherwise wait for the sender's next EPOLLIN, or for
+                // Client 2 to catch up if the pipe is still backed up
+                if (queued && pipe_.empty()) continue;
+                if (!pipe_.empty()) pause(sender);
+                return false;
+            }
+        }
+        // Senders held back by this frame go on once it has left the pipe;
+        // otherwise flushUpstream() lets them go
+        splicing_ = nullptr;
+        if (pipe_.empty()) resumeSenders();
+        return true;
+    }
+
+    // Send what pipe_ holds on to Client 2, or discard it without a link
+    void flushPipe() {
+        if (link_.fd < 0) {
+            pipe_.clear();
+            return;
+        }
+        if (pipe_.flush(link_.fd) == FlushStatus::ERROR) {
+            std::cerr << "Send to Client 2 failed: " << std::strerror(errno) << std::endl;
+            dropUpstream(&link_);
+        }
+    }
+
+    void resumeSenders() {
+        if (resuming_ || paused_.empty()) return;
+        resuming_ = true;
+        std::vector<int> paused;
+        paused.swap(paused_);
+        for (int fd : paused) {
+            auto it = connections_.find(fd);
+            if (it == connections_.end() || it->second->kind != ConnectionKind::SENDER) continue;
+            SenderConnection* sender = static_cast<SenderConnection*>(it->second.get());
+            if (!sender->paused) continue;
+            sender->paused = false;
+            readSender(sender);
+        }
+        resuming_ = false;
+    }
+
+    bool sendPersistent(const iovec* parts, int count) override {
+        if (link_.fd < 0 && !connectUpstream(&link_)) return false;
+        if (link_.connecting) {
+            link_.out.append(parts, count);
+            return true;
+        }
+        if (link_.out.sendv(link_.fd, parts, count) == FlushStatus::ERROR) {
+            std::cerr << "Send to Client 2 failed: " << std::strerror(errno) << std::endl;
+            dropUpstream(&link_);
+            return false;
+        }
+        return true;
+    }
+
+    bool sendOneShot(const iovec* parts, int count) override {
+        auto upstream = std::make_unique<UpstreamConnection>(false);
+        if (!connectUpstream(upstream.get())) return false;
+        upstream->out.append(parts, count);
+        connections_[upstream->fd] = std::move(upstream);
+        return true;
+    }
+
+    // Start a non-blocking connect; the first writable event completes it
+    bool connectUpstream(UpstreamConnection* upstream) {
+        if (upstream->persistent) {
+            log("\nConnecting to Client 2 on port " + std::to_string(CLIENT2_PORT) + "...\n");
+        }
+        upstream->fd = connectTo(CLIENT2_IP, CLIENT2_PORT, true);
+        if (upstream->fd < 0) {
+            std::cerr << "Connection to Client 2 failed. Make sure Client 2 is running." << std::endl;
+            return false;
+        }
+        if (!loop_.add(upstream->fd, EventLoop::READ_WRITE_EVENTS, upstream)) {
+            std::cerr << "epoll registration failed: " << std::strerror(errno) << std::endl;
+            close(upstream->fd);
+            upstream->fd = -1;
+            return false;
+        }
+        upstream->connecting = true;
+        return true;
+    }
+
+    void handleUpstream(UpstreamConnection* upstream, uint32_t events) {
+        if (upstream->connecting) {
+            if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) return;
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(upstream->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                std::cerr << "Connection to Client 2 failed. Make sure Client 2 is running." << std::endl;
+                dropUpstream(upstream);
+                return;
+            }
+            upstream->connecting = false;
+            if (upstream->persistent) log("Connected to Client 2!\n");
+        }
+
+        // Client 2 never writes back, so a hangup is the only input expected
+        if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            if (upstream->persistent) std::cerr << "Client 2 closed the connection" << std::endl;
+            dropUpstream(upstream);
+            return;
+        }
+        if (events & EPOLLOUT) flushUpstream(upstream);
+    }
+
+    bool flushUpstream(UpstreamConnection* upstream) {
+        FlushStatus status = upstream->out.flush(upstream->fd);
+        if (status == FlushStatus::DONE && upstream == &link_) status = pipe_.flush(upstream->fd);
+        if (status == FlushStatus::ERROR) {
+            std::cerr << "Send to Client 2 failed: " << std::strerror(errno) << std::endl;
+            dropUpstream(upstream);
+            return false;
+        }
+        if (status == FlushStatus::DONE && !upstream->persistent) {
+            closeConnection(upstream);
+        } else if (upstream->persistent && upstream->out.size() < UPSTREAM_LOW_WATERMARK && pipe_.empty()) {
+            resumeSenders();
+        }
+        return true;
+    }
+
+    // Give up on a Client 2 connection; the next binary frame reconnects
+    void dropUpstream(UpstreamConnection* upstream) {
+        size_t queued = upstream->out.size();
+        if (upstream == &link_) {
+            queued += pipe_.size();
+            pipe_.clear();
+        }
+        if (queued > 0) {
+            std::cerr << "Dropped " << queued << " byte(s) queued for Client 2" << std::endl;
+            upstream->out.clear();
+        }
+        upstream->connecting = false;
+        if (!upstream->persistent) {
+            closeConnection(upstream);
+            return;
+        }
+        close(upstream->fd);
+        upstream->fd = -1;
+        resumeSenders();
+    }
+
+    // Close now, free after the current batch of events
+    void closeConnection(Connection* connection) {
+        if (connection == splicing_) splicing_ = nullptr;
+        auto it = connections_.find(connection->fd);
+        close(connection->fd);
+        connection->fd = -1;
+        if (it != connections_.end()) {
+            closed_.push_back(std::move(it->second));
+            connections_.erase(it);
+        }
+    }
+
+    // Hand whatever is already queued for Client 2 to the kernel before exiting
+    void flushOnShutdown() {
+        std::vector<UpstreamConnection*> upstreams;
+        upstreams.push_back(&link_);
+        for (auto& entry : connections_) {
+            if (entry.second->kind == ConnectionKind::UPSTREAM) {
+                upstreams.push_back(static_cast<UpstreamConnection*>(entry.second.get()));
+            }
+        }
+        for (UpstreamConnection* upstream : upstreams) {
+            bool piped = upstream == &link_ && !pipe_.empty();
+            if (upstream->fd < 0 || upstream->connecting || (upstream->out.empty() && !piped)) continue;
+            int flags = fcntl(upstream->fd, F_GETFL, 0);
+            fcntl(upstream->fd, F_SETFL, flags & ~O_NONBLOCK);
+            if (upstream->out.flush(upstream->fd) == FlushStatus::DONE && piped) pipe_.flush(upstream->fd);
+        }
+    }
+};
+
+#ifdef URING_LOOP_AVAILABLE
+
+// Client 1 connection under io_uring. It is freed once no request refers to
+// it any more.
+struct UringSender : SenderConnection {
+    int inflight = 0;
+    bool receiving = false;     // A multishot recv is armed
+    bool ended = false;         // Client 1 closed its side
+    bool closing = false;
+
+    explicit UringSender(int fd) : SenderConnection(fd, true) {}
+};
+
+// Connection to Client 2 under io_uring. Frames forwarded while a send is in
+// flight collect in pending and leave together in the next send. Every frame
+// is copied into pending: its parts point into the sender's arena and
+// receive buffer, which are reused as soon as forwardPacket() returns, long
+// before an asynchronous send completes.
+struct UringUpstream : Connection {
+    std::string pending;
+    std::string sending;
+    size_t sent = 0;
+    sockaddr_in address;
+    bool persistent;
+    bool connecting = false;
+    bool failed = false;        // Closed once its requests have finished
+    int inflight = 0;
+
+    explicit UringUpstream(bool persistent) : Connection(ConnectionKind::UPSTREAM, -1), persistent(persistent) {
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(CLIENT2_PORT);
+        inet_aton(CLIENT2_IP, &address.sin_addr);
+    }
+
+    size_t queued() const { return pending.size() + sending.size() - sent; }
+
+    void append(const iovec* parts, int count) {
+        for (int i = 0; i < count; i++) pending.append(static_cast<const char*>(parts[i].iov_base), parts[i].iov_len);
+    }
+};
+
+// io_uring reactor (--io-uring). Accept and recv are multishot: one request
+// keeps delivering connections, another per sender keeps delivering data, in
+// buffers the kernel takes from a ring registered with it. Frames forwarded
+// while a send to Client 2 is in flight leave together in the next one.
+// Whatever handling a batch of completions queued is submitted with the
+// wait for the next batch, so a busy worker makes one system call per batch
+// rather than several per packet. A legacy packet's connection is a linked
+// connect, send and close.
+//
+// A received payload is corrupted in user space before it is sent on, so a
+// recv cannot be linked to the send of its data; the links are on the
+// Client 2 side. Sends go out from a plain buffer each frame is copied into
+// (see UringUpstream), not from registered buffers: the only buffers
+// registered with the kernel are the receive buffers.
+class UringWorker : public Worker {
+public:
+    static constexpr unsigned QUEUE_ENTRIES = 256;
+    static constexpr unsigned COMPLETION_ENTRIES = 4096;
+    static constexpr unsigned BUFFER_COUNT = 256;
+    static constexpr size_t BUFFER_SIZE = 16 * 1024;
+    static constexpr uint16_t BUFFER_GROUP = 0;
+
+    UringWorker(int shutdownFd, ChannelSource& channels, bool quiet)
+        : Worker(channels, quiet), listener_(ConnectionKind::LISTENER, -1), link_(true),
+          shutdown_(ConnectionKind::SHUTDOWN, shutdownFd) {}
+
+    ~UringWorker() override {
+        for (auto& entry : owned_) {
+            if (entry.first->fd >= 0) close(entry.first->fd);
+        }
+        if (link_.fd >= 0) close(link_.fd);
+        if (listener_.fd >= 0) close(listener_.fd);
+        if (spareFd_ >= 0) close(spareFd_);
+    }
+
+    // Set up the ring and its receive buffers; false, with the reason in
+    // error, where io_uring is missing, too old or not permitted
+    bool init(std::string& error) {
+        return loop_.init(QUEUE_ENTRIES, COMPLETION_ENTRIES, error) &&
+               buffers_.init(loop_, BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE, error);
+    }
+
+    bool start(uint16_t port, int backlog) override {
+        listener_.fd = createListenSocket(port, backlog, true);
+        if (listener_.fd < 0) {
+            std::cerr << "Listen on port " << port << " failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        armAccept();
+
+        // Polled, not read, so it wakes every worker
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = shutdown_.fd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = tag(&shutdown_, Op::SHUTDOWN);
+
+        spareFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        return true;
+    }
+
+    void run() override {
+        while (running_) {
+            flushLink();
+            if (!loop_.submitAndWait(1)) {
+                std::cerr << "io_uring_enter failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+            loop_.forEachCompletion([this](const io_uring_cqe& cqe) { complete(cqe); });
+            closed_.clear();
+        }
+        if (!stuck_) flushOnShutdown();
+    }
+
+private:
+    // Request kinds, kept in the low bits of user_data next to the connection
+    enum class Op : uintptr_t { ACCEPT, RECV, SEND, CONNECT, CLOSE, SHUTDOWN, CANCEL };
+    static constexpr uintptr_t OP_MASK = 7;
+    static_assert(alignof(Connection) > OP_MASK, "connections must leave room for the request kind");
+
+    UringLoop loop_;
+    UringBufferRing buffers_;
+    Connection listener_;
+    UringUpstream link_;
+    Connection shutdown_;
+    bool running_ = true;
+    std::unordered_map<Connection*, std::unique_ptr<Connection>> owned_;
+    std::vector<std::unique_ptr<Connection>> closed_;
+    std::vector<UringSender*> paused_;
+    int oneShots_ = 0;
+    int spareFd_ = -1;
+    bool stuck_ = false;
+    io_uring_sqe scratch_;
+
+    static uint64_t tag(Connection* connection, Op op) {
+        return reinterpret_cast<uintptr_t>(connection) | static_cast<uintptr_t>(op);
     }
 
-    sockaddr_in client2Addr;
-    client2Addr.sin_family = AF_INET;
-    client2Addr.sin_port = htons(CLIENT2_PORT);
-    if (inet_aton("127.0.0.1", &client2Addr.sin_addr) == 0) {
-        std::cerr << "Invalid address" << std::endl;
-        close(client2Socket);
-        close(listenSocket);
+    void complete(const io_uring_cqe& cqe) {
+        Connection* connection = reinterpret_cast<Connection*>(cqe.user_data & ~OP_MASK);
+        switch (static_cast<Op>(cqe.user_data & OP_MASK)) {
+            case Op::ACCEPT:
+                accepted(cqe);
+                break;
+            case Op::RECV:
+                received(static_cast<UringSender*>(connection), cqe);
+                break;
+            case Op::SEND:
+            case Op::CONNECT:
+            case Op::CLOSE:
+                upstreamDone(static_cast<UringUpstream*>(connection), static_cast<Op>(cqe.user_data & OP_MASK), cqe);
+                break;
+            case Op::SHUTDOWN:
+                running_ = false;
+                break;
+            case Op::CANCEL:
+                break;
+        }
+    }
+
+    // Where every request is queued. If the kernel stops taking them the
+    // worker stops after this batch, as it does when io_uring_enter fails;
+    // requests then go to a scratch entry that is never submitted.
+    io_uring_sqe* nextSqe() {
+        io_uring_sqe* sqe = stuck_ ? nullptr : loop_.sqe();
+        if (sqe) return sqe;
+        if (!stuck_) std::cerr << "io_uring submission queue stuck: " << std::strerror(errno) << std::endl;
+        stuck_ = true;
+        running_ = false;
+        std::memset(&scratch_, 0, sizeof(scratch_));
+        return &scratch_;
+    }
+
+    void armAccept() {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listener_.fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = tag(&listener_, Op::ACCEPT);
+    }
+
+    void accepted(const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE) && running_) armAccept();
+        if (cqe.res < 0) {
+            if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+                refuseConnection();
+            } else if (cqe.res != -ECANCELED) {
+                std::cerr << "Accept failed: " << std::strerror(-cqe.res) << std::endl;
+            }
+            return;
+        }
+        if (!running_) {
+            close(cqe.res);
+            return;
+        }
+
+        auto sender = std::make_unique<UringSender>(cqe.res);
+        sender->channel = channels_.open(sender->stream);
+        UringSender* connection = sender.get();
+        owned_[connection] = std::move(sender);
+        armRecv(connection);
+        log("Client 1 connected! (stream " + std::to_string(connection->stream) + ")\n");
+    }
+
+    // Out of descriptors: accept the pending connection on the spare one and
+    // close it at once, so the multishot accept does not report it forever
+    void refuseConnection() {
+        if (spareFd_ < 0) return;
+        close(spareFd_);
+        int fd = accept4(listener_.fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd >= 0) close(fd);
+        spareFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        std::cerr << "Too many open files, Client 1 connection refused" << std::endl;
+    }
+
+    void armRecv(UringSender* sender) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = sender->fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = tag(sender, Op::RECV);
+        sender->inflight++;
+        sender->receiving = true;
+    }
+
+    void cancelRecv(UringSender* sender) {
+        if (!sender->receiving) return;
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = tag(sender, Op::RECV);
+        sqe->user_data = tag(nullptr, Op::CANCEL);
+    }
+
+    void received(UringSender* sender, const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            sender->inflight--;
+            sender->receiving = false;
+        }
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            uint16_t id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0 && !sender->closing) sender->reader.feed(buffers_.buffer(id), static_cast<size_t>(cqe.res));
+            buffers_.recycle(id);
+        }
+        if (sender->closing) {
+            release(sender);
+            return;
+        }
+        if (cqe.res == 0) {
+            sender->ended = true;
+            sender->reader.feedEnd();
+        } else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+            // ENOBUFS: every receive buffer was taken; recv is armed again below
+            std::cerr << "Receive failed: " << std::strerror(-cqe.res) << std::endl;
+            closeSender(sender);
+            return;
+        }
+        if (!running_) return;
+
+        readSender(sender);
+        if (!sender->closing && !sender->receiving && !sender->paused && !sender->ended) armRecv(sender);
+    }
+
+    // Forward every complete message received so far
+    void readSender(UringSender* sender) {
+        Message message;
+        for (;;) {
+            // Stop receiving while Client 2 is behind; resumeSenders() picks up again
+            if (link_.queued() > UPSTREAM_HIGH_WATERMARK) {
+                if (!sender->paused) {
+                    sender->paused = true;
+                    paused_.push_back(sender);
+                    cancelRecv(sender);
+                }
+                return;
+            }
+
+            ReadStatus readStatus = sender->reader.next(message);
+            if (readStatus == ReadStatus::OK) {
+                if (forwardFrom(sender, message)) sender->forwarded++;
+                continue;
+            }
+            if (readStatus == ReadStatus::WOULD_BLOCK) return;
+            if (readStatus != ReadStatus::CLOSED) {
+                std::cerr << "Receive failed: " << MessageReader::statusToString(readStatus) << std::endl;
+            }
+            log("\nClient 1 disconnected (" + std::to_string(sender->forwarded) + " packet(s) forwarded)\n");
+            closeSender(sender);
+            return;
+        }
+    }
+
+    void resumeSenders() {
+        if (paused_.empty() || link_.queued() >= UPSTREAM_LOW_WATERMARK) return;
+        std::vector<UringSender*> paused;
+        paused.swap(paused_);
+        for (UringSender* sender : paused) {
+            sender->paused = false;
+            readSender(sender);
+            if (!sender->closing && !sender->receiving && !sender->paused && !sender->ended) armRecv(sender);
+        }
+    }
+
+    // Stop receiving and free the connection once its recv has finished
+    void closeSender(UringSender* sender) {
+        sender->closing = true;
+        paused_.erase(std::remove(paused_.begin(), paused_.end(), sender), paused_.end());
+        cancelRecv(sender);
+        release(sender);
+    }
+
+    // Free a connection no request refers to any more, after the current batch
+    void release(Connection* connection) {
+        if (connection->kind == ConnectionKind::SENDER && static_cast<UringSender*>(connection)->inflight > 0) return;
+        auto it = owned_.find(connection);
+        if (connection->fd >= 0) close(connection->fd);
+        connection->fd = -1;
+        if (it != owned_.end()) {
+            closed_.push_back(std::move(it->second));
+            owned_.erase(it);
+        }
+    }
+
+    bool sendPersistent(const iovec* parts, int count) override {
+        link_.append(parts, count);
+        if (link_.fd < 0 && !connectLink()) {
+            link_.pending.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Connect and send what is pending as one linked chain; the first
+    // frame does not wait for a completion round trip
+    bool connectLink() {
+        log("\nConnecting to Client 2 on port " + std::to_string(CLIENT2_PORT) + "...\n");
+        link_.fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (link_.fd < 0) {
+            std::cerr << "Connection to Client 2 failed. Make sure Client 2 is running." << std::endl;
+            return false;
+        }
+        link_.connecting = true;
+        submitConnect(&link_, IOSQE_IO_LINK);
+        submitSend(&link_, 0);
+        return true;
+    }
+
+    void flushLink() {
+        if (link_.fd < 0 || link_.connecting || link_.failed || link_.inflight > 0 || link_.pending.empty()) return;
+        submitSend(&link_, 0);
+    }
+
+    bool sendOneShot(const iovec* parts, int count) override {
+        auto upstream = std::make_unique<UringUpstream>(false);
+        upstream->append(parts, count);
+        upstream->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (upstream->fd < 0) {
+            std::cerr << "Connection to Client 2 failed. Make sure Client 2 is running." << std::endl;
+            return false;
+        }
+
+        // Hard links: the close runs even if the connect or send fails
+        UringUpstream* connection = upstream.get();
+        submitConnect(connection, IOSQE_IO_HARDLINK);
+        submitSend(connection, IOSQE_IO_HARDLINK);
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = connection->fd;
+        sqe->user_data = tag(connection, Op::CLOSE);
+        connection->inflight++;
+        owned_[connection] = std::move(upstream);
+        oneShots_++;
+        return true;
+    }
+
+    void submitConnect(UringUpstream* upstream, uint8_t flags) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->fd = upstream->fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(&upstream->address);
+        sqe->off = sizeof(upstream->address);
+        sqe->flags = flags;
+        sqe->user_data = tag(upstream, Op::CONNECT);
+        upstream->inflight++;
+    }
+
+    // Send everything pending; MSG_WAITALL has the kernel retry short sends
+    void submitSend(UringUpstream* upstream, uint8_t flags) {
+        if (upstream->sending.size() == upstream->sent) {
+            upstream->sending.clear();
+            upstream->sending.swap(upstream->pending);
+            upstream->sent = 0;
+        }
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = upstream->fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(upstream->sending.data() + upstream->sent);
+        sqe->len = static_cast<uint32_t>(upstream->sending.size() - upstream->sent);
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->flags = flags;
+        sqe->user_data = tag(upstream, Op::SEND);
+        upstream->inflight++;
+    }
+
+    void upstreamDone(UringUpstream* upstream, Op op, const io_uring_cqe& cqe) {
+        upstream->inflight--;
+        if (op == Op::CONNECT) {
+            if (cqe.res < 0) {
+                std::cerr << "Connection to Client 2 failed. Make sure Client 2 is running." << std::endl;
+                upstream->failed = true;
+            } else {
+                upstream->connecting = false;
+                if (upstream->persistent) log("Connected to Client 2!\n");
+            }
+        } else if (op == Op::SEND) {
+            if (cqe.res < 0) {
+                if (!upstream->failed && cqe.res != -ECANCELED) {
+                    std::cerr << "Send to Client 2 failed: " << std::strerror(-cqe.res) << std::endl;
+                }
+                upstream->failed = true;
+            } else {
+                upstream->sent += static_cast<size_t>(cqe.res);
+                if (upstream->sent < upstream->sending.size() && !upstream->failed) submitSend(upstream, 0);
+            }
+        } else {
+            upstream->fd = -1;     // Closed by the chain
+        }
+
+        if (!upstream->persistent) {
+            if (upstream->inflight == 0) {
+                oneShots_--;
+                release(upstream);
+            }
+        } else if (upstream->failed) {
+            if (upstream->inflight == 0) dropLink();
+        } else {
+            resumeSenders();
+        }
+    }
+
+    // Give up on the link; the next binary frame reconnects
+    void dropLink() {
+        if (link_.queued() > 0) {
+            std::cerr << "Dropped " << link_.queued() << " byte(s) queued for Client 2" << std::endl;
+        }
+        link_.pending.clear();
+        link_.sending.clear();
+        link_.sent = 0;
+        close(link_.fd);
+        link_.fd = -1;
+        link_.connecting = false;
+        link_.failed = false;
+        resumeSenders();
+    }
+
+    // Hand whatever is already queued for Client 2 to the kernel before exiting
+    void flushOnShutdown() {
+        for (;;) {
+            flushLink();
+            bool linkBusy = link_.fd >= 0 && !link_.failed && (link_.inflight > 0 || !link_.pending.empty());
+            if (!linkBusy && oneShots_ == 0) break;
+            if (!loop_.submitAndWait(1)) break;
+            loop_.forEachCompletion([this](const io_uring_cqe& cqe) { complete(cqe); });
+            closed_.clear();
+        }
+    }
+};
+
+#endif // URING_LOOP_AVAILABLE
+
+// Corrupts binary frames where they lie, for the transports that hand the
+// server whole frames instead of a byte stream (--shm and --udp). The control
+// field follows the payload and moves with its end; its first bytes are saved
+// first because a growing payload overwrites them. A frame therefore needs
+// MAX_GROWTH spare bytes after it.
+class FrameCorruptor {
+public:
+    FrameCorruptor(ChannelSource& channels, bool quiet) : channels_(channels), quiet_(quiet) {}
+
+    // Corrupt the frame at the start of buffer, with length bytes of it
+    // available and capacity bytes of room, and return its new size. Returns
+    // 0 and sets status if there is no valid frame; bytes after it are left.
+    size_t corrupt(uint8_t* buffer, size_t length, size_t capacity, ChannelModel& channel, uint64_t stream,
+                   const char* note, FrameStatus& status) {
+        Message message;
+        message.binary = true;
+        status = PacketFrame::parse(buffer, length, message.frame, length);
+        if (status != FrameStatus::OK) return 0;
+        const FrameHeader& header = message.frame.header;
+        message.size = message.frame.size();
+        if (capacity < message.size + ErrorInjection::MAX_GROWTH) {
+            status = FrameStatus::TOO_LARGE;
+            return 0;
+        }
+        uint8_t* payload = buffer + PacketFrame::HEADER_SIZE;
+        size_t original = header.payloadLength;
+        size_t controlLength = header.controlLength;
+        if (!quiet_) original_.assign(reinterpret_cast<const char*>(payload), original);
+
+        uint8_t saved[ErrorInjection::MAX_GROWTH];
+        size_t kept = std::min(controlLength, ErrorInjection::MAX_GROWTH);
+        std::memcpy(saved, payload + original, kept);
+
+        CorruptionEdits* edits = nullptr;
+        if (channels_.trace.isOpen()) {
+            edits_.clear();
+            edits = &edits_;
+        }
+        size_t corrupted = original;
+        size_t errors = channel.apply(reinterpret_cast<char*>(payload), corrupted,
+                                      original + ErrorInjection::MAX_GROWTH, edits);
+        if (corrupted != original) {
+            std::memmove(payload + corrupted + kept, payload + original + kept, controlLength - kept);
+            PacketFrame::writeHeader(buffer, header.method, header.sequence, corrupted, controlLength, header.flags);
+        }
+        std::memcpy(payload + corrupted, saved, kept);
+        if (edits) channels_.trace.append(stream, header.sequence, original, errors, edits_);
+
+        size_t size = PacketFrame::HEADER_SIZE + corrupted + controlLength;
+        if (!quiet_) {
+            PacketFrame::parse(buffer, size, message.frame, size);
+            std::string_view corruptedData = message.frame.payloadView();
+            writeOutput(describePacket(message, LegacyPacket(), original_, corruptedData, errors) + note);
+        }
+        return size;
+    }
+
+private:
+    ChannelSource& channels_;
+    bool quiet_;
+    CorruptionEdits edits_;
+    std::string original_;      // Payload before corruption, for the log
+};
+
+// Corrupts frames inside the shared-memory ring (--shm) between Client 1
+// writing them and Client 2 reading them, without copying them anywhere.
+// Every attachment to a ring Client 2 created is one stream.
+class RingCorruptor {
+public:
+    static_assert(ShmRing::FRAME_SLACK >= ErrorInjection::MAX_GROWTH, "ring records must fit a grown payload");
+
+    RingCorruptor(ChannelSource& channels, bool quiet) : channels_(channels), quiet_(quiet), corruptor_(channels, quiet) {}
+
+    void run() {
+        bool waiting = false;
+        while (!stopped_.load(std::memory_order_relaxed)) {
+            std::string error;
+            if (!ring_.open(SHM_RING_NAME, RingStage::CORRUPTOR, error)) {
+                if (!waiting) {
+                    std::cerr << "Shared-memory ring unavailable (" << error
+                              << "), waiting for Client 2 --shm" << std::endl;
+                    waiting = true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(RING_TIMEOUT_MS));
+                continue;
+            }
+            waiting = false;
+            channel_ = channels_.open(stream_);
+            if (!quiet_) writeOutput("\nAttached to the shared-memory ring (stream " + std::to_string(stream_) + ")\n");
+            serve();
+            ring_.close();
+        }
+    }
+
+    void stop() { stopped_.store(true, std::memory_order_relaxed); }
+
+private:
+    ChannelSource& channels_;
+    bool quiet_;
+    FrameCorruptor corruptor_;
+    std::atomic<bool> stopped_{false};
+    ShmRing ring_;
+    std::unique_ptr<ChannelModel> channel_;
+    uint64_t stream_ = 0;
+
+    void serve() {
+        while (!stopped_.load(std::memory_order_relaxed)) {
+            uint8_t* frame;
+            size_t capacity;
+            RingStatus status = ring_.next(frame, capacity, RING_TIMEOUT_MS);
+            if (status == RingStatus::TIMEOUT) continue;
+            if (status != RingStatus::OK) {
+                std::cerr << "Client 2 closed the shared-memory ring" << std::endl;
+                return;
+            }
+            FrameStatus frameStatus;
+            if (corruptor_.corrupt(frame, capacity, capacity, *channel_, stream_,
+                                   "Corrupted frame passed on in the shared-memory ring\n", frameStatus) == 0) {
+                std::cerr << "Invalid frame in the shared-memory ring: " << PacketFrame::statusToString(frameStatus)
+                          << std::endl;
+            }
+            ring_.release();
+        }
+    }
+};
+
+// Forwards UDP datagrams (--udp) from Client 1 to Client 2, one frame each.
+// Every sender address is a stream with its own channel and its own socket
+// towards Client 2, so Client 2 tells the streams apart by source port and
+// checks the sequence numbers of each. A batch is corrupted in the receive
+// buffer and sent on from there with one sendmmsg() per stream. Datagrams
+// are never retransmitted: what the kernel drops reaches Client 2 as a gap.
+class DatagramForwarder {
+public:
+    static_assert(DatagramReceiver::SLOT_SIZE >= UDP_MAX_DATAGRAM + ErrorInjection::MAX_GROWTH,
+                  "receive slots must fit a grown datagram");
+
+    DatagramForwarder(ChannelSource& channels, bool quiet) : channels_(channels), quiet_(quiet), corruptor_(channels, quiet) {}
+
+    ~DatagramForwarder() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    bool start(int port) {
+        fd_ = createUdpSocket(static_cast<uint16_t>(port), nullptr, 0, UDP_TIMEOUT_MS);
+        if (fd_ < 0) {
+            std::cerr << "UDP socket on port " << port << " failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        // GRO stays off: a datagram split off a coalesced run has no room to grow
+        receiver_ = std::make_unique<DatagramReceiver>(fd_, false);
+        return true;
+    }
+
+    void run() {
+        std::vector<Datagram> batch;
+        std::vector<Peer*> active;
+        auto lastExpiry = std::chrono::steady_clock::now();
+        while (!stopped_.load(std::memory_order_relaxed)) {
+            if (!receiver_->receive(batch)) {
+                std::cerr << "UDP receive failed: " << std::strerror(errno) << std::endl;
+                return;
+            }
+            auto now = std::chrono::steady_clock::now();
+            for (Datagram& datagram : batch) {
+                Peer* peer = peerFor(datagram.from, now);
+                if (!peer) continue;
+                FrameStatus status;
+                size_t size = corruptor_.corrupt(datagram.data, datagram.size, datagram.capacity, *peer->channel,
+                                                 peer->stream, "Corrupted frame forwarded as a datagram\n", status);
+                if (size == 0) {
+                    std::cerr << "Invalid datagram from " << describe(datagram.from) << ": "
+                              << PacketFrame::statusToString(status) << std::endl;
+                    continue;
+                }
+                if (!peer->active) {
+                    peer->active = true;
+                    active.push_back(peer);
+                }
+                peer->out->add(datagram.data, size);
+            }
+            for (Peer* peer : active) {
+                peer->active = false;
+                if (!peer->out->flush()) {
+                    std::cerr << "Forwarding datagrams to Client 2 failed: " << std::strerror(errno) << std::endl;
+                }
+            }
+            active.clear();
+
+            if (now - lastExpiry >= std::chrono::seconds(1)) {
+                expireIdle(now);
+                lastExpiry = now;
+            }
+        }
+    }
+
+    void stop() { stopped_.store(true, std::memory_order_relaxed); }
+
+private:
+    struct Peer {
+        int fd = -1;
+        uint64_t stream = 0;
+        std::unique_ptr<ChannelModel> channel;
+        std::unique_ptr<DatagramSender> out;
+        std::chrono::steady_clock::time_point lastSeen;
+        bool active = false;
+
+        ~Peer() {
+            if (fd >= 0) close(fd);
+        }
+    };
+
+    ChannelSource& channels_;
+    bool quiet_;
+    FrameCorruptor corruptor_;
+    std::atomic<bool> stopped_{false};
+    int fd_ = -1;
+    std::unique_ptr<DatagramReceiver> receiver_;
+    std::unordered_map<uint64_t, std::unique_ptr<Peer>> peers_;
+
+    static std::string describe(const sockaddr_in& addr) {
+        return std::string(inet_ntoa(addr.sin_addr)) + ":" + std::to_string(ntohs(addr.sin_port));
+    }
+
+    Peer* peerFor(const sockaddr_in& from, std::chrono::steady_clock::time_point now) {
+        std::unique_ptr<Peer>& peer = peers_[peerKey(from)];
+        if (!peer) {
+            auto created = std::make_unique<Peer>();
+            created->fd = createUdpSocket(0, CLIENT2_IP, CLIENT2_PORT, UDP_TIMEOUT_MS);
+            if (created->fd < 0) {
+                std::cerr << "UDP socket to Client 2 failed: " << std::strerror(errno) << std::endl;
+                peers_.erase(peerKey(from));
+                return nullptr;
+            }
+            created->out = std::make_unique<DatagramSender>(created->fd);
+            created->channel = channels_.open(created->stream);
+            if (!quiet_) {
+                writeOutput("\nNew UDP sender " + describe(from) + " (stream " + std::to_string(created->stream) +
+                            (created->out->gso() ? ", GSO" : "") + ")\n");
+            }
+            peer = std::move(created);
+        }
+        peer->lastSeen = now;
+        return peer.get();
+    }
+
+    // A sender that stopped is forgotten; if it resumes it is a new stream
+    void expireIdle(std::chrono::steady_clock::time_point now) {
+        for (auto it = peers_.begin(); it != peers_.end();) {
+            Peer& peer = *it->second;
+            if (now - peer.lastSeen < std::chrono::seconds(UDP_PEER_IDLE_SECONDS)) {
+                ++it;
+                continue;
+            }
+            if (!quiet_ || peer.out->dropped() > 0) {
+                writeOutput("\nUDP stream " + std::to_string(peer.stream) + " idle, closed after " +
+                            std::to_string(peer.out->datagrams()) + " datagram(s) forwarded, " +
+                            std::to_string(peer.out->dropped()) + " dropped\n");
+            }
+            it = peers_.erase(it);
+        }
+    }
+};
+
+// An io_uring worker if one was asked for and the kernel allows it, an epoll
+// worker otherwise. After the first failure every worker uses epoll.
+std::unique_ptr<Worker> createWorker(bool& uring, int shutdownFd, ChannelSource& channels, bool quiet) {
+#ifdef URING_LOOP_AVAILABLE
+    if (uring) {
+        auto worker = std::make_unique<UringWorker>(shutdownFd, channels, quiet);
+        std::string error;
+        if (worker->init(error)) return worker;
+        std::cerr << "io_uring unavailable (" << error << "), using epoll" << std::endl;
+    }
+#else
+    if (uring) std::cerr << "Built without io_uring support, using epoll" << std::endl;
+#endif
+    uring = false;
+    return std::make_unique<EpollWorker>(shutdownFd, channels, quiet);
+}
+
+// Thousands of connections need more descriptors than the usual soft limit
+void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // --backlog N sets the queue of not yet accepted connections, which
+    // absorbs bursts of new senders (the kernel caps it at net.core.somaxconn).
+    // --workers N runs N reactor threads (default: one per core).
+    // --channel SPEC picks the channel model (see ChannelModel::create).
+    // --seed N fixes the master seed the per-connection generators derive from.
+    // --trace FILE records every corruption applied (see corruption_trace.h).
+    // --replay FILE applies the corruptions of a recorded run instead.
+    // --shm also corrupts frames in the shared-memory ring Client 2 creates.
+    // --udp also forwards datagrams from UDP port SERVER_PORT to CLIENT2_PORT.
+    // --io-uring runs the workers on io_uring instead of epoll where the
+    // kernel allows it.
+    // --quiet drops the per-packet log.
+    int backlog = LISTEN_BACKLOG;
+    int workers = static_cast<int>(std::thread::hardware_concurrency());
+    ChannelSource channels;
+    channels.spec = "random";
+    channels.seed = ErrorInjection::randomSeed();
+    std::string tracePath;
+    std::string replayPath;
+    bool quiet = false;
+    bool shm = false;
+    bool udp = false;
+    bool uring = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--backlog") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            backlog = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            workers = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+            channels.spec = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            channels.seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--shm") == 0) {
+            shm = true;
+        } else if (std::strcmp(argv[i], "--udp") == 0) {
+            udp = true;
+        } else if (std::strcmp(argv[i], "--io-uring") == 0) {
+            uring = true;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--backlog N] [--workers N] [--channel SPEC] [--seed N]\n"
+                      << "       [--trace FILE] [--replay FILE] [--shm] [--udp] [--io-uring] [--quiet]\n"
+                      << "Channel models: random, ber:P, ge:P_GB,P_BG[,BER_GOOD[,BER_BAD]], erasure:P[,SPAN]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (workers < 1) workers = 1;
+    if (!KernelSelfCheck::verify()) return 1;
+    if (!replayPath.empty()) {
+        auto replay = std::make_shared<CorruptionTrace>();
+        std::string error;
+        if (!replay->load(replayPath, error)) {
+            std::cerr << "Cannot replay " << replayPath << ": " << error << std::endl;
+            return 1;
+        }
+        channels.spec = replay->channel();
+        channels.seed = replay->seed();
+        channels.replay = std::move(replay);
+    }
+    if (!ChannelModel::create(channels.spec)) {
+        std::cerr << "Invalid channel model: " << channels.spec << std::endl;
+        return 1;
+    }
+    if (!tracePath.empty() && !channels.trace.open(tracePath, channels.seed, channels.spec)) {
+        std::cerr << "Cannot write trace " << tracePath << ": " << std::strerror(errno) << std::endl;
         return 1;
     }
 
-    std::cout << "\nConnecting to Client 2 on port " << CLIENT2_PORT << "..." << std::endl;
+    // Block SIGINT/SIGTERM in every thread; the main thread waits for them
+    // with sigwait() and then wakes the workers through an eventfd
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
 
-    if (connect(client2Socket, (sockaddr*)&client2Addr, sizeof(client2Addr)) < 0) {
-        std::cerr << "Connection to Client 2 failed. Make sure Client 2 is running." << std::endl;
-        close(client2Socket);
-        close(listenSocket);
+    // A splice() into a socket Client 2 has closed raises SIGPIPE; the call
+    // fails with EPIPE all the same
+    std::signal(SIGPIPE, SIG_IGN);
+
+    raiseFileLimit();
+
+    int shutdownFd = eventfd(0, EFD_CLOEXEC);
+    if (shutdownFd < 0) {
+        std::cerr << "eventfd creation failed: " << std::strerror(errno) << std::endl;
         return 1;
     }
 
-    std::cout << "Connected to Client 2!" << std::endl;
+    std::vector<std::unique_ptr<Worker>> pool;
+    for (int i = 0; i < workers; i++) {
+        pool.push_back(createWorker(uring, shutdownFd, channels, quiet));
+        if (!pool.back()->start(SERVER_PORT, backlog)) return 1;
+    }
+    std::unique_ptr<DatagramForwarder> forwarder;
+    if (udp) {
+        forwarder = std::make_unique<DatagramForwarder>(channels, quiet);
+        if (!forwarder->start(SERVER_PORT)) return 1;
+    }
+
+    std::cout << "=== Server: Intermediate Node + Data Corruptor ===" << std::endl;
+    std::cout << "Waiting for Client 1 on port " << SERVER_PORT << " (" << workers
+              << (uring ? " io_uring" : "") << " worker thread(s), channel " << channels.spec << ", seed " << channels.seed
+              << (channels.replay ? ", replaying " + replayPath : std::string())
+              << (shm ? ", shared-memory ring " SHM_RING_NAME : "") << (udp ? ", UDP datagrams" : "") << ")..."
+              << std::endl;
+    std::cout << "Detector kernels: " << CpuDispatch::levelToString(CpuDispatch::level()) << std::endl;
 
-    // Send corrupted packet to Client 2
-    ssize_t bytesSent = send(client2Socket, corruptedPacket.c_str(), corruptedPacket.length(), 0);
-    if (bytesSent < 0) {
-        std::cerr << "Send to Client 2 failed" << std::endl;
-    } else {
-        std::cout << "Corrupted packet sent to Client 2 (" << bytesSent << " bytes)" << std::endl;
+    std::vector<std::thread> threads;
+    for (auto& worker : pool) {
+        threads.emplace_back(&Worker::run, worker.get());
     }
+    std::unique_ptr<RingCorruptor> corruptor;
+    if (shm) {
+        corruptor = std::make_unique<RingCorruptor>(channels, quiet);
+        threads.emplace_back(&RingCorruptor::run, corruptor.get());
+    }
+    if (forwarder) threads.emplace_back(&DatagramForwarder::run, forwarder.get());
 
-    // Close sockets
-    close(client2Socket);
-    close(listenSocket);
+    int signal = 0;
+    sigwait(&signals, &signal);
+
+    uint64_t one = 1;
+    if (write(shutdownFd, &one, sizeof(one)) < 0) {
+        std::cerr << "Shutdown notification failed: " << std::strerror(errno) << std::endl;
+    }
+    if (corruptor) corruptor->stop();
+    if (forwarder) forwarder->stop();
+    for (std::thread& thread : threads) thread.join();
+    pool.clear();
+    close(shutdownFd);
+    if (!channels.trace.close()) {
+        std::cerr << "Writing trace " << tracePath << " failed" << std::endl;
+    }
 
     std::cout << "\nServer finished." << std::endl;
     return 0;
 }
-
@@ -0,0 +1,314 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include "packet_frame.h"
+
+#define SHM_RING_NAME "/edc-ring"
+#define SHM_RING_CAPACITY (16 * 1024 * 1024)
+
+// Same-host transport (--shm): one shared-memory ring that frames pass
+// through in three stages. Client 1 writes a frame into it, the server
+// corrupts the frame where it lies, and Client 2 checks it and frees the
+// space. Each stage owns a cursor that only it advances and that only the
+// next stage waits on, so every hop is single-producer single-consumer and
+// needs no locks. Cursors sit on cache lines of their own.
+//
+// A stage with nothing to do spins briefly, then raises the sleeping flag of
+// the cursor it waits on and sleeps on it as a futex. The stage that moves
+// the cursor makes the wake-up call only when that flag is raised, so a busy
+// pipeline runs without a system call per frame.
+//
+// Records start at 8-byte aligned positions with a RingRecord, followed by
+// the frame and FRAME_SLACK spare bytes the server's corruption may grow it
+// into. A record never wraps around the end of the ring; the space left
+// there is skipped with a padding record.
+
+enum class RingStage : int {
+    SENDER = 0,     // Client 1
+    CORRUPTOR = 1,  // Server
+    RECEIVER = 2    // Client 2, which creates the ring
+};
+
+enum class RingStatus {
+    OK,
+    TIMEOUT,        // Nothing arrived in time; call again
+    TOO_LARGE,      // Frame larger than half the ring
+    CLOSED          // Client 2 closed the ring or exited
+};
+
+struct RingRecord {
+    uint32_t capacity;  // Bytes after this header
+    uint32_t padding;   // Nonzero if the record only skips to the ring start
+};
+
+struct alignas(64) RingCursor {
+    std::atomic<uint64_t> position;     // Bytes the stage is done with
+    std::atomic<uint32_t> sleeping;     // The next stage waits for position to move
+    std::atomic<int32_t> owner;         // pid of the attached process, 0 if none
+};
+
+struct RingControl {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    std::atomic<uint32_t> closed;
+    RingCursor cursors[3];
+};
+
+class ShmRing {
+public:
+    static constexpr uint32_t MAGIC = 0x45444352;  // "EDCR"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t FRAME_SLACK = 8;
+    static constexpr int SPIN_ITERATIONS = 4096;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring cursors must be lock-free");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "ring flags must be lock-free");
+
+    ShmRing() = default;
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+    ~ShmRing() { close(); }
+
+    // The receiver creates a fresh ring, replacing any stale one; the other
+    // stages attach to it. Only one process may hold each stage.
+    bool open(const char* name, RingStage stage, std::string& error, size_t capacity = SHM_RING_CAPACITY) {
+        close();
+        stage_ = stage;
+        name_ = name;
+        bool create = stage == RingStage::RECEIVER;
+        int fd;
+        if (create) {
+            shm_unlink(name);
+            fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        } else {
+            fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+        }
+        if (fd < 0) {
+            error = std::string("shm_open ") + name + ": " + std::strerror(errno);
+            return false;
+        }
+
+        size_t mapped = sizeof(RingControl) + capacity;
+        if (create) {
+            if (ftruncate(fd, static_cast<off_t>(mapped)) < 0) {
+                error = std::string("ftruncate: ") + std::strerror(errno);
+                ::close(fd);
+                shm_unlink(name);
+                return false;
+            }
+        } else {
+            struct stat info;
+            if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(RingControl)) {
+                error = "ring is not initialized yet";
+                ::close(fd);
+                return false;
+            }
+            mapped = static_cast<size_t>(info.st_size);
+        }
+
+        void* base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            error = std::string("mmap: ") + std::strerror(errno);
+            if (create) shm_unlink(name);
+            return false;
+        }
+        control_ = static_cast<RingControl*>(base);
+        mapped_ = mapped;
+        data_ = static_cast<uint8_t*>(base) + sizeof(RingControl);
+
+        if (create) {
+            control_->capacity = capacity;
+            control_->version = VERSION;
+            std::atomic_thread_fence(std::memory_order_release);
+            reinterpret_cast<std::atomic<uint32_t>*>(&control_->magic)->store(MAGIC, std::memory_order_release);
+        } else if (reinterpret_cast<std::atomic<uint32_t>*>(&control_->magic)->load(std::memory_order_acquire) != MAGIC ||
+                   control_->version != VERSION || control_->capacity + sizeof(RingControl) > mapped ||
+                   (control_->capacity & (control_->capacity - 1)) != 0) {
+            error = "not a ring of this version";
+            unmap();
+            return false;
+        }
+        if (control_->closed.load(std::memory_order_acquire)) {
+            error = "ring was closed by Client 2";
+            unmap();
+            return false;
+        }
+        capacity_ = control_->capacity;
+
+        RingCursor& own = cursor(stage);
+        int32_t owner = own.owner.load(std::memory_order_acquire);
+        int32_t self = static_cast<int32_t>(getpid());
+        while (owner != self) {
+            if (owner != 0 && processAlive(owner)) {
+                error = "stage is in use by process " + std::to_string(owner);
+                unmap();
+                return false;
+            }
+            if (own.owner.compare_exchange_weak(owner, self, std::memory_order_acq_rel)) break;
+        }
+        position_ = own.position.load(std::memory_order_acquire);
+        recordEnd_ = position_;
+        return true;
+    }
+
+    // Detach; the receiver also closes the ring for the other stages
+    void close() {
+        if (!control_) return;
+        cursor(stage_).owner.store(0, std::memory_order_release);
+        if (stage_ == RingStage::RECEIVER) {
+            control_->closed.store(1, std::memory_order_seq_cst);
+            for (RingCursor& c : control_->cursors) wake(c);
+            shm_unlink(name_.c_str());
+        }
+        unmap();
+    }
+
+    bool isOpen() const { return control_ != nullptr; }
+
+    // Sender: room for a frame of frameSize bytes plus FRAME_SLACK. Waits
+    // up to timeoutMs for Client 2 to free enough space.
+    RingStatus reserve(size_t frameSize, uint8_t*& frame, int timeoutMs) {
+        size_t needed = align(sizeof(RingRecord) + frameSize + FRAME_SLACK);
+        if (needed > capacity_ / 2) return RingStatus::TOO_LARGE;
+        size_t offset = position_ & (capacity_ - 1);
+        size_t skip = offset + needed > capacity_ ? capacity_ - offset : 0;
+
+        RingCursor& freed = cursor(RingStage::RECEIVER);
+        uint64_t limit = freed.position.load(std::memory_order_acquire) + capacity_;
+        while (limit - position_ < skip + needed) {
+            RingStatus status = waitFor(freed, limit - capacity_, timeoutMs);
+            if (status != RingStatus::OK) return status;
+            limit = freed.position.load(std::memory_order_acquire) + capacity_;
+        }
+
+        if (skip > 0) {
+            writeRecord(offset, static_cast<uint32_t>(skip - sizeof(RingRecord)), 1);
+            offset = 0;
+        }
+        writeRecord(offset, static_cast<uint32_t>(needed - sizeof(RingRecord)), 0);
+        recordEnd_ = position_ + skip + needed;
+        frame = data_ + offset + sizeof(RingRecord);
+        return RingStatus::OK;
+    }
+
+    // Sender: hand the frame written into the last reservation on
+    void commit() {
+        position_ = recordEnd_;
+        advance(cursor(RingStage::SENDER), position_);
+    }
+
+    // Corruptor and receiver: the next frame, in place, with the room its
+    // record has for it. Waits up to timeoutMs for the previous stage.
+    RingStatus next(uint8_t*& frame, size_t& capacity, int timeoutMs) {
+        RingCursor& previous = cursor(static_cast<RingStage>(static_cast<int>(stage_) - 1));
+        for (;;) {
+            uint64_t limit = previous.position.load(std::memory_order_acquire);
+            if (limit == position_) {
+                RingStatus status = waitFor(previous, position_, timeoutMs);
+                if (status != RingStatus::OK) return status;
+                continue;
+            }
+            size_t offset = position_ & (capacity_ - 1);
+            RingRecord record;
+            std::memcpy(&record, data_ + offset, sizeof(record));
+            if (record.padding) {
+                position_ += sizeof(RingRecord) + record.capacity;
+                continue;
+            }
+            frame = data_ + offset + sizeof(RingRecord);
+            capacity = record.capacity;
+            recordEnd_ = position_ + sizeof(RingRecord) + record.capacity;
+            return RingStatus::OK;
+        }
+    }
+
+    // Corruptor and receiver: pass the frame from next() on to the next stage
+    void release() {
+        position_ = recordEnd_;
+        advance(cursor(stage_), position_);
+    }
+
+private:
+    RingControl* control_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t mapped_ = 0;
+    size_t capacity_ = 0;
+    RingStage stage_ = RingStage::RECEIVER;
+    std::string name_;
+    uint64_t position_ = 0;     // Own progress, published by commit()/release()
+    uint64_t recordEnd_ = 0;    // End of the record being worked on
+
+    static size_t align(size_t size) { return (size + 7) & ~static_cast<size_t>(7); }
+
+    static bool processAlive(int32_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+
+    RingCursor& cursor(RingStage stage) { return control_->cursors[static_cast<int>(stage)]; }
+
+    void writeRecord(size_t offset, uint32_t capacity, uint32_t padding) {
+        RingRecord record = {capacity, padding};
+        std::memcpy(data_ + offset, &record, sizeof(record));
+    }
+
+    // The other stages give up on the ring once Client 2 is gone
+    bool closed() {
+        if (control_->closed.load(std::memory_order_acquire)) return true;
+        if (stage_ == RingStage::RECEIVER) return false;
+        int32_t receiver = cursor(RingStage::RECEIVER).owner.load(std::memory_order_acquire);
+        return receiver == 0 || !processAlive(receiver);
+    }
+
+    // Wait until the cursor moves away from seen
+    RingStatus waitFor(RingCursor& c, uint64_t seen, int timeoutMs) {
+        for (int i = 0; i < SPIN_ITERATIONS; i++) {
+            if (c.position.load(std::memory_order_acquire) != seen) return RingStatus::OK;
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        if (closed()) return RingStatus::CLOSED;
+
+        // Dekker handshake with advance(): either it sees the flag and wakes
+        // us, or we see the new position and do not sleep
+        c.sleeping.store(1, std::memory_order_seq_cst);
+        if (c.position.load(std::memory_order_seq_cst) == seen) {
+            timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+            syscall(SYS_futex, &c.sleeping, FUTEX_WAIT, 1, &timeout, nullptr, 0);
+        }
+        c.sleeping.store(0, std::memory_order_relaxed);
+        if (c.position.load(std::memory_order_acquire) != seen) return RingStatus::OK;
+        return closed() ? RingStatus::CLOSED : RingStatus::TIMEOUT;
+    }
+
+    void advance(RingCursor& c, uint64_t position) {
+        c.position.store(position, std::memory_order_seq_cst);
+        if (c.sleeping.load(std::memory_order_seq_cst)) wake(c);
+    }
+
+    static void wake(RingCursor& c) {
+        c.sleeping.store(0, std::memory_order_relaxed);
+        syscall(SYS_futex, &c.sleeping, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    void unmap() {
+        munmap(control_, mapped_);
+        control_ = nullptr;
+        data_ = nullptr;
+    }
+};
+
+#endif // SHM_RING_H
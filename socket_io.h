@@ -0,0 +1,532 @@
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "packet_frame.h"
+
+// Set by a program's main thread once it has received SIGINT or SIGTERM;
+// threads that wait with a timeout check it to stop
+inline std::atomic<bool>& shutdownRequested() {
+    static std::atomic<bool> requested{false};
+    return requested;
+}
+
+// Create a TCP socket listening on all interfaces; returns -1 on failure.
+// With reusePort several sockets can listen on the same port and the kernel
+// spreads incoming connections across them.
+inline int createListenSocket(uint16_t port, int backlog, bool reusePort = false) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Connect a TCP socket to ip:port; returns -1 on failure. A non-blocking
+// connect may still be in progress when this returns; the socket becomes
+// writable once it completes and SO_ERROR holds the result.
+inline int connectTo(const char* ip, uint16_t port, bool nonBlocking = false) {
+    int fd = socket(AF_INET, nonBlocking ? SOCK_STREAM | SOCK_NONBLOCK : SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_aton(ip, &addr.sin_addr) == 0 ||
+        (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0 && !(nonBlocking && errno == EINPROGRESS))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+enum class ReadStatus {
+    OK,
+    CLOSED,         // Peer closed the connection between messages
+    TRUNCATED,      // Peer closed the connection in the middle of a message
+    TOO_LARGE,      // Message exceeds the configured maximum size
+    MALFORMED,      // Binary frame header failed validation
+    WOULD_BLOCK,    // Non-blocking socket has no more data yet; call next() again later
+    HEADER,         // Pass-through only: a large frame's header is buffered, its rest is not
+    ERROR           // recv() failed
+};
+
+// One complete message, viewing the reader's buffer. Valid until the next
+// call to MessageReader::next().
+struct Message {
+    bool binary = false;
+    FrameView frame;            // Binary frame
+    std::string_view text;      // Legacy DATA|METHOD|CONTROL packet
+    size_t size = 0;            // Bytes the message occupied on the wire
+};
+
+// Reassembles complete messages from a stream socket across partial reads.
+// Binary frames end where their header says; a legacy text packet has no
+// length, so it ends when the peer closes the connection. The buffer grows
+// up to the maximum message size and is reused for every message.
+//
+// A reader made with fd -1 does not receive by itself: bytes received
+// elsewhere (by io_uring) are handed to it with feed(), and next() reports
+// WOULD_BLOCK once they are used up.
+//
+// With setPassThrough(), a frame of at least the given size is reported as
+// HEADER before its payload is read. The caller either takes the frame over
+// with takeFrame() and reads the rest from the socket itself, or calls next()
+// again to have it assembled as usual. Receives then stop READ_AHEAD bytes
+// past the message being assembled, so later frames stay in the socket.
+class MessageReader {
+public:
+    static constexpr size_t INITIAL_CAPACITY = 64 * 1024;
+    static constexpr size_t READ_AHEAD = 4 * 1024;
+
+    explicit MessageReader(int fd, size_t maxMessageSize = PacketFrame::DEFAULT_MAX_PAYLOAD,
+                           size_t initialCapacity = INITIAL_CAPACITY)
+        : fd_(fd), maxMessageSize_(maxMessageSize), buffer_(initialCapacity) {}
+
+    ReadStatus next(Message& message) {
+        // Release the previous message
+        start_ += consumed_;
+        consumed_ = 0;
+        if (start_ == end_) start_ = end_ = 0;
+
+        for (;;) {
+            const uint8_t* data = buffer_.data() + start_;
+            size_t available = end_ - start_;
+            size_t missing = 0;     // Bytes of the current frame not yet buffered
+
+            if (available >= 4 || (eof_ && available > 0)) {
+                if (PacketFrame::isFrame(data, available)) {
+                    frameStatus_ = PacketFrame::parse(data, available, message.frame, maxMessageSize_);
+                    if (frameStatus_ == FrameStatus::OK) {
+                        message.binary = true;
+                        message.text = std::string_view();
+                        message.size = message.frame.size();
+                        consumed_ = message.size;
+                        offered_ = false;
+                        return ReadStatus::OK;
+                    }
+                    if (frameStatus_ == FrameStatus::TOO_LARGE) return ReadStatus::TOO_LARGE;
+                    if (frameStatus_ != FrameStatus::INCOMPLETE) return ReadStatus::MALFORMED;
+                    if (eof_) return ReadStatus::TRUNCATED;
+
+                    // Make room for the whole frame at once once its size is known
+                    if (available >= PacketFrame::HEADER_SIZE) {
+                        if (passThrough_ > 0 && !offered_ && message.frame.size() >= passThrough_) {
+                            offered_ = true;
+                            message.binary = true;
+                            message.text = std::string_view();
+                            message.size = message.frame.size();
+                            return ReadStatus::HEADER;
+                        }
+                        reserve(message.frame.size());
+                        missing = message.frame.size() - available;
+                    }
+                } else if (eof_) {
+                    message.binary = false;
+                    message.text = std::string_view(reinterpret_cast<const char*>(data), available);
+                    message.size = available;
+                    consumed_ = available;
+                    return ReadStatus::OK;
+                } else if (available > maxMessageSize_) {
+                    return ReadStatus::TOO_LARGE;
+                }
+            } else if (eof_) {
+                return ReadStatus::CLOSED;
+            }
+
+            ssize_t n = fill(passThrough_ > 0 ? missing + READ_AHEAD : buffer_.size());
+            if (n < 0) {
+                return (errno == EAGAIN || errno == EWOULDBLOCK) ? ReadStatus::WOULD_BLOCK : ReadStatus::ERROR;
+            }
+            if (n == 0) eof_ = true;
+        }
+    }
+
+    // Append received bytes. This may move the buffer, so not while the
+    // last message from next() is still in use.
+    void feed(const uint8_t* data, size_t length) {
+        if (end_ + length > buffer_.size()) {
+            if (start_ > 0) compact();
+            if (end_ + length > buffer_.size()) buffer_.resize(std::max(end_ + length, buffer_.size() * 2));
+        }
+        std::memcpy(buffer_.data() + end_, data, length);
+        end_ += length;
+    }
+
+    // The peer closed the connection; what is buffered is all there is
+    void feedEnd() { eof_ = true; }
+
+    // Report frames of at least minimumSize as HEADER (0 turns this off)
+    void setPassThrough(size_t minimumSize) { passThrough_ = minimumSize; }
+
+    // Take over the frame just reported as HEADER: returns its buffered
+    // start, valid until the next call to next(). The caller must read the
+    // other message.size - prefix.size() bytes from the socket before that.
+    std::string_view takeFrame() {
+        offered_ = false;
+        consumed_ = end_ - start_;
+        return std::string_view(reinterpret_cast<const char*>(buffer_.data() + start_), consumed_);
+    }
+
+    FrameStatus lastFrameStatus() const { return frameStatus_; }
+    size_t buffered() const { return end_ - start_ - consumed_; }
+
+    static const char* statusToString(ReadStatus status) {
+        switch (status) {
+            case ReadStatus::OK: return "OK";
+            case ReadStatus::CLOSED: return "connection closed";
+            case ReadStatus::TRUNCATED: return "connection closed mid-message";
+            case ReadStatus::TOO_LARGE: return "message too large";
+            case ReadStatus::MALFORMED: return "malformed frame";
+            case ReadStatus::WOULD_BLOCK: return "no data available";
+            case ReadStatus::HEADER: return "frame header only";
+            case ReadStatus::ERROR: return "receive failed";
+            default: return "unknown";
+        }
+    }
+
+private:
+    int fd_;
+    size_t maxMessageSize_;
+    std::vector<uint8_t> buffer_;
+    size_t start_ = 0;
+    size_t end_ = 0;
+    size_t consumed_ = 0;
+    bool eof_ = false;
+    FrameStatus frameStatus_ = FrameStatus::OK;
+    size_t passThrough_ = 0;
+    bool offered_ = false;      // The incomplete frame was reported as HEADER
+
+    void compact() {
+        std::memmove(buffer_.data(), buffer_.data() + start_, end_ - start_);
+        end_ -= start_;
+        start_ = 0;
+    }
+
+    // Ensure `needed` bytes fit from the start of the unread data
+    void reserve(size_t needed) {
+        if (start_ + needed <= buffer_.size()) return;
+        if (start_ > 0) compact();
+        if (needed > buffer_.size()) buffer_.resize(needed);
+    }
+
+    // Receive up to limit bytes
+    ssize_t fill(size_t limit) {
+        if (fd_ < 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        if (end_ == buffer_.size()) {
+            if (start_ > 0) {
+                compact();
+            } else {
+                buffer_.resize(buffer_.size() * 2);
+            }
+        }
+        for (;;) {
+            ssize_t n = recv(fd_, buffer_.data() + end_, std::min(buffer_.size() - end_, limit), 0);
+            if (n < 0 && errno == EINTR && !shutdownRequested()) continue;
+            if (n > 0) end_ += static_cast<size_t>(n);
+            return n;
+        }
+    }
+};
+
+// Send the whole buffer, retrying after short writes
+inline bool sendAll(int fd, const void* data, size_t length) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Send scattered parts whole with as few sendmsg() calls as the socket
+// allows; parts is advanced past what was sent
+inline bool sendAllv(int fd, iovec* parts, int count) {
+    while (count > 0) {
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = parts;
+        message.msg_iovlen = static_cast<size_t>(count);
+        ssize_t n = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        size_t sent = static_cast<size_t>(n);
+        while (count > 0 && sent >= parts->iov_len) {
+            sent -= parts->iov_len;
+            parts++;
+            count--;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + sent;
+            parts->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+// Scratch memory for the message a connection is working on. allocate()
+// bumps an offset through one block and reset() frees everything at once
+// when the message is done. A message that does not fit spills into blocks
+// of its own, and the next reset() replaces the block with one that holds
+// all of it, so a connection stops allocating once it has seen its largest
+// message. An idle connection holds no block at all.
+class FrameArena {
+public:
+    static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+    explicit FrameArena(size_t initialCapacity = 0)
+        : block_(initialCapacity ? new char[initialCapacity] : nullptr), capacity_(initialCapacity) {}
+
+    char* allocate(size_t size) {
+        size_t offset = (used_ + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (offset <= capacity_ && size <= capacity_ - offset) {
+            used_ = offset + size;
+            return block_.get() + offset;
+        }
+        spilled_.emplace_back(new char[size ? size : 1]);
+        spilledBytes_ += size + ALIGNMENT;
+        return spilled_.back().get();
+    }
+
+    // Release everything allocated since the last reset
+    void reset() {
+        if (!spilled_.empty()) {
+            capacity_ = used_ + spilledBytes_;
+            block_.reset(new char[capacity_]);
+            spilled_.clear();
+            spilledBytes_ = 0;
+        }
+        used_ = 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    std::unique_ptr<char[]> block_;
+    size_t capacity_;
+    size_t used_ = 0;
+    std::vector<std::unique_ptr<char[]>> spilled_;
+    size_t spilledBytes_ = 0;
+};
+
+enum class FlushStatus {
+    DONE,       // Everything queued has been written
+    PENDING,    // Socket buffer is full; flush again once it is writable
+    ERROR       // send() failed, the connection is unusable
+};
+
+// Outgoing bytes for a non-blocking socket. Data that the kernel does not
+// take immediately stays queued until the next flush().
+class WriteBuffer {
+public:
+    void append(std::string_view data) {
+        // Drop already-sent bytes before they dominate the buffer
+        if (sent_ > 0 && sent_ >= data_.size() / 2) {
+            data_.erase(0, sent_);
+            sent_ = 0;
+        }
+        data_.append(data.data(), data.size());
+    }
+
+    // Queue scattered parts in order, skipping their first `skip` bytes
+    void append(const iovec* parts, int count, size_t skip = 0) {
+        for (int i = 0; i < count; i++) {
+            if (skip >= parts[i].iov_len) {
+                skip -= parts[i].iov_len;
+                continue;
+            }
+            append(std::string_view(static_cast<const char*>(parts[i].iov_base) + skip, parts[i].iov_len - skip));
+            skip = 0;
+        }
+    }
+
+    // Send scattered parts with one sendmsg() when nothing is queued ahead
+    // of them, so they are never copied into the buffer unless the kernel
+    // cannot take them all right away
+    FlushStatus sendv(int fd, const iovec* parts, int count) {
+        if (!empty()) {
+            append(parts, count);
+            return flush(fd);
+        }
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = const_cast<iovec*>(parts);
+        message.msg_iovlen = static_cast<size_t>(count);
+        ssize_t n;
+        do {
+            n = sendmsg(fd, &message, MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return FlushStatus::ERROR;
+            n = 0;
+        }
+        append(parts, count, static_cast<size_t>(n));
+        return empty() ? FlushStatus::DONE : FlushStatus::PENDING;
+    }
+
+    FlushStatus flush(int fd) {
+        while (sent_ < data_.size()) {
+            ssize_t n = send(fd, data_.data() + sent_, data_.size() - sent_, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return FlushStatus::PENDING;
+                return FlushStatus::ERROR;
+            }
+            sent_ += static_cast<size_t>(n);
+        }
+        clear();
+        return FlushStatus::DONE;
+    }
+
+    size_t size() const { return data_.size() - sent_; }
+    bool empty() const { return size() == 0; }
+
+    void clear() {
+        data_.clear();
+        sent_ = 0;
+    }
+
+private:
+    std::string data_;
+    size_t sent_ = 0;
+};
+
+// Kernel pipe that moves bytes between sockets with splice(), so they never
+// enter user space. Bytes go in from a socket or from memory and come out to
+// a socket in the same order. A splice() into a closed socket raises SIGPIPE
+// like a plain write().
+class SplicePipe {
+public:
+    static constexpr int CAPACITY = 1024 * 1024;
+
+    SplicePipe() = default;
+    SplicePipe(const SplicePipe&) = delete;
+    SplicePipe& operator=(const SplicePipe&) = delete;
+
+    ~SplicePipe() {
+        if (readFd_ >= 0) close(readFd_);
+        if (writeFd_ >= 0) close(writeFd_);
+    }
+
+    bool open() {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) return false;
+        readFd_ = fds[0];
+        writeFd_ = fds[1];
+        // Best effort: capped by fs.pipe-max-size, and 64 KB is enough to work
+        fcntl(writeFd_, F_SETPIPE_SZ, CAPACITY);
+        return true;
+    }
+
+    bool valid() const { return readFd_ >= 0; }
+
+    // Copy bytes in; false if the pipe cannot take them all
+    bool write(const void* data, size_t length) {
+        const char* p = static_cast<const char*>(data);
+        while (length > 0) {
+            ssize_t n = ::write(writeFd_, p, length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            length -= static_cast<size_t>(n);
+            size_ += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Move up to length bytes in from a socket. Returns the bytes moved, 0 at
+    // EOF, or -1 with EAGAIN once the socket is drained or the pipe is full.
+    ssize_t fromSocket(int fd, size_t length) {
+        ssize_t n;
+        do {
+            n = splice(fd, nullptr, writeFd_, nullptr, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } while (n < 0 && errno == EINTR);
+        if (n > 0) size_ += static_cast<size_t>(n);
+        return n;
+    }
+
+    // Move everything queued out to a socket
+    FlushStatus flush(int fd) {
+        while (size_ > 0) {
+            ssize_t n = splice(readFd_, nullptr, fd, nullptr, size_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return FlushStatus::PENDING;
+                return FlushStatus::ERROR;
+            }
+            size_ -= static_cast<size_t>(n);
+        }
+        return FlushStatus::DONE;
+    }
+
+    // Discard everything queued
+    void clear() {
+        char scratch[4096];
+        while (size_ > 0) {
+            ssize_t n = read(readFd_, scratch, std::min(size_, sizeof(scratch)));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            size_ -= static_cast<size_t>(n);
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    int readFd_ = -1;
+    int writeFd_ = -1;
+    size_t size_ = 0;
+};
+
+#endif // SOCKET_IO_H
@@ -0,0 +1,267 @@
+#ifndef UDP_IO_H
+#define UDP_IO_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// UDP transport (--udp): one binary frame per datagram, so loss and
+// reordering reach Client 2 instead of being repaired by TCP. Sends and
+// receives are batched with sendmmsg()/recvmmsg(), one system call moving up
+// to BATCH datagrams. Where the kernel supports it, a run of equal-sized
+// datagrams leaves as a single UDP GSO send, and a receiver with UDP GRO takes
+// a coalesced run at once and splits it itself.
+
+#define UDP_MAX_DATAGRAM 65507          // Largest UDP payload over IPv4
+#define UDP_SOCKET_BUFFER (8 * 1024 * 1024)
+
+// Open a UDP socket bound to bindPort (0 for any port) and, if ip is given,
+// connected to ip:port. Receives time out after timeoutMs so callers can
+// check for shutdown. Returns -1 on failure.
+inline int createUdpSocket(uint16_t bindPort, const char* ip = nullptr, uint16_t port = 0, int timeoutMs = 200) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    // Best effort: the kernel caps these at net.core.[rw]mem_max
+    int size = UDP_SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(bindPort);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bindPort != 0 && bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (ip) {
+        addr.sin_port = htons(port);
+        if (inet_aton(ip, &addr.sin_addr) == 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+// Source address and port as one map key
+inline uint64_t peerKey(const sockaddr_in& addr) {
+    return (static_cast<uint64_t>(ntohl(addr.sin_addr.s_addr)) << 16) | ntohs(addr.sin_port);
+}
+
+// One received datagram, pointing into the receiver's buffer until the next
+// receive(). capacity is the room at data: a whole slot for a datagram of
+// its own, exactly size for one split off a GRO run.
+struct Datagram {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    sockaddr_in from;
+};
+
+class DatagramReceiver {
+public:
+    static constexpr int BATCH = 64;
+    static constexpr size_t SLOT_SIZE = 64 * 1024 + 64;
+
+    DatagramReceiver(int fd, bool gro) : fd_(fd), buffer_(BATCH * SLOT_SIZE) {
+        int on = 1;
+        gro_ = gro && setsockopt(fd, IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+        std::memset(messages_, 0, sizeof(messages_));
+        for (int i = 0; i < BATCH; i++) {
+            iov_[i].iov_base = buffer_.data() + i * SLOT_SIZE;
+            iov_[i].iov_len = SLOT_SIZE;
+            messages_[i].msg_hdr.msg_iov = &iov_[i];
+            messages_[i].msg_hdr.msg_iovlen = 1;
+            messages_[i].msg_hdr.msg_name = &from_[i];
+        }
+    }
+
+    // Wait for a datagram, up to the socket's receive timeout, then take
+    // whatever else is queued, up to BATCH messages. out is empty after a
+    // timeout; false means the socket failed.
+    bool receive(std::vector<Datagram>& out) {
+        out.clear();
+        for (int i = 0; i < BATCH; i++) {
+            messages_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages_[i].msg_hdr.msg_control = gro_ ? control_[i] : nullptr;
+            messages_[i].msg_hdr.msg_controllen = gro_ ? sizeof(control_[i]) : 0;
+        }
+        int n = recvmmsg(fd_, messages_, BATCH, MSG_WAITFORONE, nullptr);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+        for (int i = 0; i < n; i++) {
+            const msghdr& header = messages_[i].msg_hdr;
+            uint8_t* slot = buffer_.data() + i * SLOT_SIZE;
+            size_t size = messages_[i].msg_len;
+            if (header.msg_flags & MSG_TRUNC) {
+                truncated_++;
+                continue;
+            }
+            size_t segment = gro_ ? groSegment(header) : 0;
+            if (segment == 0 || segment >= size) {
+                out.push_back({slot, size, SLOT_SIZE, from_[i]});
+                continue;
+            }
+            for (size_t offset = 0; offset < size; offset += segment) {
+                size_t length = size - offset < segment ? size - offset : segment;
+                out.push_back({slot + offset, length, length, from_[i]});
+            }
+        }
+        return true;
+    }
+
+    bool gro() const { return gro_; }
+    uint64_t truncated() const { return truncated_; }
+
+private:
+    int fd_;
+    bool gro_;
+    std::vector<uint8_t> buffer_;
+    iovec iov_[BATCH];
+    mmsghdr messages_[BATCH];
+    sockaddr_in from_[BATCH];
+    alignas(cmsghdr) char control_[BATCH][CMSG_SPACE(sizeof(int))];
+    uint64_t truncated_ = 0;
+
+    static size_t groSegment(const msghdr& header) {
+        for (cmsghdr* c = CMSG_FIRSTHDR(&header); c; c = CMSG_NXTHDR(const_cast<msghdr*>(&header), c)) {
+            if (c->cmsg_level == IPPROTO_UDP && c->cmsg_type == UDP_GRO) {
+                int segment;
+                std::memcpy(&segment, CMSG_DATA(c), sizeof(segment));
+                return segment > 0 ? static_cast<size_t>(segment) : 0;
+            }
+        }
+        return 0;
+    }
+};
+
+// Queues datagrams for a connected UDP socket and sends them with one
+// sendmmsg() per flush. Consecutive datagrams of one size (the last of a run
+// may be shorter) go out as a single GSO message of up to MAX_SEGMENTS.
+// Datagrams the kernel refuses are dropped and counted, as the network would.
+class DatagramSender {
+public:
+    static constexpr int BATCH = 64;
+    static constexpr int MAX_SEGMENTS = 64;
+
+    explicit DatagramSender(int fd) : fd_(fd) {
+        int off = 0;
+        gso_ = setsockopt(fd, IPPROTO_UDP, UDP_SEGMENT, &off, sizeof(off)) == 0;
+        std::memset(messages_, 0, sizeof(messages_));
+    }
+
+    // Queue a datagram; data must stay valid until the next flush().
+    // Returns false if a flush to make room failed.
+    bool add(const void* data, size_t size) {
+        bool ok = true;
+        if (count_ == BATCH) ok = flush();
+        parts_[count_].iov_base = const_cast<void*>(data);
+        parts_[count_].iov_len = size;
+        count_++;
+        return ok;
+    }
+
+    // Send everything queued; false if the socket is unusable
+    bool flush() {
+        int messages = 0;
+        for (int i = 0; i < count_;) {
+            int run = gso_ ? gsoRun(i) : 1;
+            mmsghdr& message = messages_[messages];
+            std::memset(&message, 0, sizeof(message));
+            message.msg_hdr.msg_iov = &parts_[i];
+            message.msg_hdr.msg_iovlen = static_cast<size_t>(run);
+            if (run > 1) {
+                cmsghdr* c = reinterpret_cast<cmsghdr*>(control_[messages]);
+                c->cmsg_level = IPPROTO_UDP;
+                c->cmsg_type = UDP_SEGMENT;
+                c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segment = static_cast<uint16_t>(parts_[i].iov_len);
+                std::memcpy(CMSG_DATA(c), &segment, sizeof(segment));
+                message.msg_hdr.msg_control = control_[messages];
+                message.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            }
+            runs_[messages] = run;
+            messages++;
+            i += run;
+        }
+
+        bool ok = true;
+        for (int sent = 0; sent < messages;) {
+            int n = sendmmsg(fd_, messages_ + sent, static_cast<unsigned>(messages - sent), 0);
+            if (n > 0) {
+                for (int k = sent; k < sent + n; k++) datagrams_ += runs_[k];
+                sent += n;
+                continue;
+            }
+            if (errno == EINTR) continue;
+            if (gso_ && runs_[sent] > 1 && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP)) {
+                // No GSO on this path after all: send the rest one by one
+                gso_ = false;
+                int first = 0;
+                for (int k = 0; k < sent; k++) first += runs_[k];
+                std::memmove(parts_, parts_ + first, (count_ - first) * sizeof(iovec));
+                count_ -= first;
+                return flush();
+            }
+            // Refused (e.g. ICMP port unreachable) or no buffer space: the
+            // datagrams of this message are lost, the rest still go out
+            dropped_ += runs_[sent];
+            if (errno != ECONNREFUSED && errno != ENOBUFS && errno != EAGAIN && errno != EMSGSIZE) ok = false;
+            sent++;
+        }
+        count_ = 0;
+        return ok;
+    }
+
+    bool gso() const { return gso_; }
+    uint64_t datagrams() const { return datagrams_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    int fd_;
+    bool gso_;
+    int count_ = 0;
+    iovec parts_[BATCH];
+    mmsghdr messages_[BATCH];
+    int runs_[BATCH];
+    alignas(cmsghdr) char control_[BATCH][CMSG_SPACE(sizeof(uint16_t))];
+    uint64_t datagrams_ = 0;
+    uint64_t dropped_ = 0;
+
+    // Datagrams from first on that can share one GSO message
+    int gsoRun(int first) const {
+        size_t segment = parts_[first].iov_len;
+        size_t total = segment;
+        int run = 1;
+        while (first + run < count_ && run < MAX_SEGMENTS) {
+            size_t next = parts_[first + run].iov_len;
+            if (next > segment || total + next > UDP_MAX_DATAGRAM - 8) break;
+            total += next;
+            run++;
+            if (next < segment) break;
+        }
+        return run;
+    }
+};
+
+#endif // UDP_IO_H
@@ -0,0 +1,313 @@
+#ifndef URING_LOOP_H
+#define URING_LOOP_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// Multishot recv (Linux 6.0) is the newest feature the server relies on;
+// older headers build without io_uring and always fall back to epoll
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_RECV_MULTISHOT
+#define URING_LOOP_AVAILABLE 1
+#endif
+#endif
+
+#ifdef URING_LOOP_AVAILABLE
+
+// Thin io_uring wrapper over the raw system calls, so nothing beyond the
+// kernel headers is needed. Requests are queued with sqe() and submitted in
+// one go by the next submitAndWait(), which also waits for completions;
+// completions are then handed out by forEachCompletion(). Every request
+// carries a caller-chosen 64-bit tag in user_data.
+//
+// A full submission queue is submitted early by sqe(). The kernel may hold
+// back (EBUSY) while completions it could not post are waiting for room, so
+// sqe() then moves the ready completions aside, in order, for the next
+// forEachCompletion() and tries again; an entry the kernel has not consumed
+// is never handed out a second time.
+class UringLoop {
+public:
+    UringLoop() = default;
+    UringLoop(const UringLoop&) = delete;
+    UringLoop& operator=(const UringLoop&) = delete;
+
+    ~UringLoop() {
+        if (sqes_) munmap(sqes_, sqesSize_);
+        if (rings_) munmap(rings_, ringsSize_);
+        if (fd_ >= 0) close(fd_);
+    }
+
+    // Create the ring and make sure the kernel has every operation the
+    // server uses; error says what is missing otherwise
+    bool init(unsigned entries, unsigned completions, std::string& error) {
+        if (!kernelAtLeast(6, 0)) {
+            error = "multishot recv needs Linux 6.0 or later";
+            return false;
+        }
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+        params.cq_entries = completions;
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            error = std::string("io_uring_setup: ") + std::strerror(errno);
+            return false;
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+            error = "io_uring lacks single mmap or no-drop completions";
+            return false;
+        }
+
+        // Both rings share one mapping; the entries have their own
+        size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringsSize_ = sqSize > cqSize ? sqSize : cqSize;
+        rings_ = map(ringsSize_, IORING_OFF_SQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqesSize_, IORING_OFF_SQES));
+        if (!rings_ || !sqes_) {
+            error = std::string("mmap: ") + std::strerror(errno);
+            return false;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(rings_);
+        sqHead_ = reinterpret_cast<std::atomic<uint32_t>*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<std::atomic<uint32_t>*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+        sqEntries_ = params.sq_entries;
+        uint32_t* array = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+        for (uint32_t i = 0; i < sqEntries_; i++) array[i] = i;
+        cqHead_ = reinterpret_cast<std::atomic<uint32_t>*>(sq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<std::atomic<uint32_t>*>(sq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<uint32_t*>(sq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(sq + params.cq_off.cqes);
+        tail_ = sqTail_->load(std::memory_order_relaxed);
+        submitted_ = tail_;
+        stash_.reserve(params.cq_entries);
+        return probe(error);
+    }
+
+    // A cleared submission entry, submitting what is queued if the queue is
+    // full; nullptr, with errno set, if the kernel stops taking entries
+    io_uring_sqe* sqe() {
+        while (full()) {
+            if (!submitAndWait(0)) return nullptr;
+            if (!full()) break;
+            if (stashCompletions() > 0) continue;
+            // Nothing ready yet: have the kernel post what it is holding back
+            if (syscall(__NR_io_uring_enter, fd_, 0, 0, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                return nullptr;
+            }
+            if (stashCompletions() == 0) {
+                errno = EBUSY;
+                return nullptr;
+            }
+        }
+        io_uring_sqe* entry = &sqes_[tail_ & sqMask_];
+        std::memset(entry, 0, sizeof(*entry));
+        tail_++;
+        return entry;
+    }
+
+    // Submit everything queued and wait until at least waitFor completions
+    // are ready; returns false if io_uring_enter failed
+    bool submitAndWait(unsigned waitFor) {
+        for (;;) {
+            sqTail_->store(tail_, std::memory_order_release);
+            unsigned pending = tail_ - submitted_;
+            if (pending == 0 && waitFor == 0) return true;
+            if (waitFor > 0 && ready() >= waitFor) waitFor = 0;
+            long n = syscall(__NR_io_uring_enter, fd_, pending, waitFor,
+                             waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                // Completion queue full: reap, then submit again
+                if (errno == EBUSY || errno == EAGAIN) return true;
+                return false;
+            }
+            submitted_ += static_cast<unsigned>(n);
+            return true;
+        }
+    }
+
+    // Call f(const io_uring_cqe&) for every ready completion, those sqe()
+    // moved aside first
+    template <typename F>
+    unsigned forEachCompletion(F&& f) {
+        unsigned count = 0;
+        for (;;) {
+            // Copied out, since f may queue requests that complete into the
+            // slot or make sqe() stash more
+            io_uring_cqe cqe;
+            if (stashed_ < stash_.size()) {
+                cqe = stash_[stashed_++];
+            } else {
+                uint32_t head = cqHead_->load(std::memory_order_relaxed);
+                if (head == cqTail_->load(std::memory_order_acquire)) break;
+                cqe = cqes_[head & cqMask_];
+                cqHead_->store(head + 1, std::memory_order_release);
+            }
+            f(cqe);
+            count++;
+        }
+        stash_.clear();
+        stashed_ = 0;
+        return count;
+    }
+
+    int fd() const { return fd_; }
+
+    static bool kernelAtLeast(int major, int minor) {
+        utsname name;
+        if (uname(&name) != 0) return false;
+        char* end;
+        long kernelMajor = std::strtol(name.release, &end, 10);
+        long kernelMinor = *end == '.' ? std::strtol(end + 1, nullptr, 10) : 0;
+        return kernelMajor > major || (kernelMajor == major && kernelMinor >= minor);
+    }
+
+private:
+    int fd_ = -1;
+    void* rings_ = nullptr;
+    size_t ringsSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    std::atomic<uint32_t>* sqHead_ = nullptr;
+    std::atomic<uint32_t>* sqTail_ = nullptr;
+    uint32_t sqMask_ = 0;
+    uint32_t sqEntries_ = 0;
+    std::atomic<uint32_t>* cqHead_ = nullptr;
+    std::atomic<uint32_t>* cqTail_ = nullptr;
+    uint32_t cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    uint32_t tail_ = 0;         // Local submission tail, published on submit
+    uint32_t submitted_ = 0;    // Entries the kernel has consumed
+    std::vector<io_uring_cqe> stash_;   // Completions taken off the ring by sqe()
+    size_t stashed_ = 0;                // Of which already handed out
+
+    bool full() const { return tail_ - sqHead_->load(std::memory_order_acquire) >= sqEntries_; }
+
+    unsigned ready() const {
+        return static_cast<unsigned>(stash_.size() - stashed_) +
+               (cqTail_->load(std::memory_order_acquire) - cqHead_->load(std::memory_order_relaxed));
+    }
+
+    // Move every completion on the ring into stash_, freeing its slots
+    unsigned stashCompletions() {
+        uint32_t head = cqHead_->load(std::memory_order_relaxed);
+        uint32_t tail = cqTail_->load(std::memory_order_acquire);
+        for (uint32_t i = head; i != tail; i++) stash_.push_back(cqes_[i & cqMask_]);
+        cqHead_->store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    void* map(size_t size, uint64_t offset) {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, static_cast<off_t>(offset));
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    bool probe(std::string& error) {
+        const uint8_t required[] = {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_CONNECT,
+                                    IORING_OP_CLOSE, IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL};
+        const size_t count = 256;
+        std::vector<uint8_t> storage(sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op));
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, count) < 0) {
+            error = std::string("io_uring probe: ") + std::strerror(errno);
+            return false;
+        }
+        for (uint8_t op : required) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                error = "io_uring lacks operation " + std::to_string(op);
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Receive buffers registered with the kernel as a provided buffer ring:
+// a multishot recv takes the next free buffer for every completion and
+// reports its id, and the owner gives it back with recycle() once the data
+// has been consumed.
+class UringBufferRing {
+public:
+    UringBufferRing() = default;
+    UringBufferRing(const UringBufferRing&) = delete;
+    UringBufferRing& operator=(const UringBufferRing&) = delete;
+
+    ~UringBufferRing() {
+        if (ring_) munmap(ring_, ringSize_);
+    }
+
+    // count must be a power of two
+    bool init(UringLoop& loop, uint16_t group, unsigned count, size_t bufferSize, std::string& error) {
+        count_ = count;
+        bufferSize_ = bufferSize;
+        ringSize_ = count * sizeof(io_uring_buf);
+        void* ring = mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            error = std::string("mmap: ") + std::strerror(errno);
+            return false;
+        }
+        ring_ = static_cast<io_uring_buf*>(ring);
+        buffers_.resize(count * bufferSize);
+
+        io_uring_buf_reg registration;
+        std::memset(&registration, 0, sizeof(registration));
+        registration.ring_addr = reinterpret_cast<uint64_t>(ring_);
+        registration.ring_entries = count;
+        registration.bgid = group;
+        if (syscall(__NR_io_uring_register, loop.fd(), IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+            error = std::string("registering receive buffers: ") + std::strerror(errno);
+            return false;
+        }
+        for (unsigned id = 0; id < count; id++) add(static_cast<uint16_t>(id));
+        publish();
+        return true;
+    }
+
+    uint8_t* buffer(uint16_t id) { return buffers_.data() + static_cast<size_t>(id) * bufferSize_; }
+
+    // Hand a buffer back to the kernel
+    void recycle(uint16_t id) {
+        add(id);
+        publish();
+    }
+
+private:
+    io_uring_buf* ring_ = nullptr;
+    size_t ringSize_ = 0;
+    unsigned count_ = 0;
+    size_t bufferSize_ = 0;
+    uint16_t tail_ = 0;
+    std::vector<uint8_t> buffers_;
+
+    void add(uint16_t id) {
+        io_uring_buf& entry = ring_[tail_ & (count_ - 1)];
+        entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+        entry.len = static_cast<uint32_t>(bufferSize_);
+        entry.bid = id;
+        tail_++;
+    }
+
+    // The tail shares the first entry's reserved field
+    void publish() {
+        reinterpret_cast<std::atomic<uint16_t>*>(&reinterpret_cast<io_uring_buf_ring*>(ring_)->tail)
+            ->store(tail_, std::memory_order_release);
+    }
+};
+
+#endif // URING_LOOP_AVAILABLE
+
+#endif // URING_LOOP_H